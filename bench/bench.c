@@ -0,0 +1,445 @@
+// Microbenchmarks for the parts of the game that don't need SDL, written as
+// JSON so runs can be compared over time
+#include "board.h"
+#include "hints.h"
+#include "cluestate.h"
+#include "generator.h"
+#include "solver.h"
+#include "util.h"
+#include "version.h"
+#include "mtnlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_REPEAT 64
+#define BENCH_CELLS_PER_REP 4000000 // whole-board benchmarks repeat up to this many cells
+#define BENCH_OPS_PER_REP 1000000
+#define BENCH_SOLVE_ATTEMPTS 50 // random grids the generator tries per solver board
+
+static const int _sizes[] = {5, 10, 15, 25, 50, 100, 250, 500, 1000};
+
+typedef struct s_bench_options {
+    uint64_t seed;
+    double density;
+    double solveDensity;
+    int repeat;
+    int maxSize;
+} BenchOptions;
+
+// One benchmark at one board size. Every rep does ops operations.
+typedef struct s_bench_case {
+    Board board; // solved until boardSetCell scrambles it
+    unsigned char *solution; // packed
+    int numBoards; // boards solverSolve runs on
+    int size;
+    char *text; // the first board as a level file
+    size_t textLen;
+    int *cellX; // random cells for boardSetCell
+    int *cellY;
+    unsigned char *cellState;
+} BenchCase;
+
+static volatile long _sink; // keeps results of calls the compiler could otherwise drop
+
+// splitmix64, same as the generator
+static uint64_t _nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static int _compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Whole-board benchmarks run on enough boards that small sizes aren't lost in
+// timer noise
+static int _boardsPerRep(int size)
+{
+    long cells = (long)size * size;
+    return cells >= BENCH_CELLS_PER_REP ? 1 : (int)(BENCH_CELLS_PER_REP / cells);
+}
+
+static char *_boardText(Board *board, size_t *len)
+{
+    int size = board->size;
+    size_t cap = 64 + (size_t)size * (size + 1);
+    char *text = (char *)malloc(cap);
+    if (!text)
+        return NULL;
+    int n = snprintf(text, cap, "nm Bench %d\nau pikurosu_bench\nsz %d\ns\n", size, size);
+    char *p = text + n;
+    unsigned char *bits = (unsigned char *)malloc(boardPackedSize(size));
+    if (!bits) {
+        free(text);
+        return NULL;
+    }
+    boardPackSolution(board, bits);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            size_t i = (size_t)y * size + x;
+            *p++ = (bits[i >> 3] >> (i & 7)) & 1 ? '#' : '_';
+        }
+        *p++ = '\n';
+    }
+    free(bits);
+    *len = p - text;
+    return text;
+}
+
+static void _destroyCase(BenchCase *bc)
+{
+    free(bc->solution);
+    boardDestroy(&bc->board);
+    free(bc->text);
+    free(bc->cellX);
+    free(bc->cellY);
+    free(bc->cellState);
+}
+
+static bool _createCase(BenchCase *bc, BenchOptions *options, int size)
+{
+    memset(bc, 0, sizeof(BenchCase));
+    bc->size = size;
+    bc->numBoards = size <= 100 ? 16 : size <= 250 ? 4 : 1;
+    bc->solution = (unsigned char *)calloc(boardPackedSize(size), 1);
+    if (!bc->solution)
+        return false;
+
+    // the same seed and size always give the same board
+    uint64_t rng = options->seed ^ ((uint64_t)size * 0xd1b54a32d192ed03ull);
+    uint64_t threshold = options->density >= 1.0 ? UINT64_MAX : (uint64_t)(options->density * 18446744073709551616.0);
+    for (size_t i = 0; i < (size_t)size * size; i++) {
+        if (_nextRandom(&rng) < threshold)
+            bc->solution[i >> 3] |= 1 << (i & 7);
+    }
+    if (!boardLoadPacked(&bc->board, bc->solution, size))
+        return false;
+    // boardMatchesSolution stops at the first difference, a solved board makes it scan everything
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            size_t i = (size_t)y * size + x;
+            if ((bc->solution[i >> 3] >> (i & 7)) & 1)
+                boardSetCell(&bc->board, x, y, CellState_Filled);
+        }
+    }
+    bc->text = _boardText(&bc->board, &bc->textLen);
+
+    bc->cellX = (int *)malloc(BENCH_OPS_PER_REP * sizeof(int));
+    bc->cellY = (int *)malloc(BENCH_OPS_PER_REP * sizeof(int));
+    bc->cellState = (unsigned char *)malloc(BENCH_OPS_PER_REP);
+    if (!bc->text || !bc->cellX || !bc->cellY || !bc->cellState)
+        return false;
+    for (int i = 0; i < BENCH_OPS_PER_REP; i++) {
+        uint64_t r = _nextRandom(&rng);
+        bc->cellX[i] = (int)((r & 0xffff) % size);
+        bc->cellY[i] = (int)(((r >> 16) & 0xffff) % size);
+        bc->cellState[i] = (unsigned char)((r >> 32) % 3);
+    }
+    return true;
+}
+
+static long _benchLoad(BenchCase *bc)
+{
+    int count = _boardsPerRep(bc->size);
+    for (int i = 0; i < count; i++) {
+        Board board;
+        BoardMetadata meta;
+        BoardLoadError err;
+        if (boardLoadBuffer(&board, &meta, bc->text, bc->textLen, &err)) {
+            _sink += board.mismatches;
+            boardDestroy(&board);
+            boardMetaDestroy(&meta);
+        }
+    }
+    return count;
+}
+
+static long _benchSetCell(BenchCase *bc)
+{
+    for (int i = 0; i < BENCH_OPS_PER_REP; i++)
+        boardSetCell(&bc->board, bc->cellX[i], bc->cellY[i], (CellState)bc->cellState[i]);
+    return BENCH_OPS_PER_REP;
+}
+
+// Clue tracking for the board, started in _runSize
+static BoardHints _clueHints;
+static ClueState _clues;
+
+// A whole move: boardSetCell and the row and column it touched
+static long _benchClueUpdate(BenchCase *bc)
+{
+    long changed = 0;
+    for (int i = 0; i < BENCH_OPS_PER_REP; i++) {
+        boardSetCell(&bc->board, bc->cellX[i], bc->cellY[i], (CellState)bc->cellState[i]);
+        changed += clueStateUpdate(&_clues, bc->cellX[i], bc->cellY[i]);
+    }
+    _sink += changed;
+    return BENCH_OPS_PER_REP;
+}
+
+static long _benchIsSolved(BenchCase *bc)
+{
+    long solved = 0;
+    for (int i = 0; i < BENCH_OPS_PER_REP; i++)
+        solved += boardIsSolved(&bc->board);
+    _sink += solved;
+    return BENCH_OPS_PER_REP;
+}
+
+// The full scan boardIsSolved's counters replace
+static long _benchMatchesSolution(BenchCase *bc)
+{
+    int count = _boardsPerRep(bc->size);
+    long matches = 0;
+    for (int i = 0; i < count; i++)
+        matches += boardMatchesSolution(&bc->board);
+    _sink += matches;
+    return count;
+}
+
+static long _benchHints(BenchCase *bc)
+{
+    int count = _boardsPerRep(bc->size);
+    for (int i = 0; i < count; i++) {
+        BoardHints hints;
+        if (hintsCreate(&hints, &bc->board)) {
+            _sink += hints.lines[0];
+            hintsDestroy(&hints);
+        }
+    }
+    return count;
+}
+
+typedef struct s_solve_stats {
+    int solved;
+    int stuck;
+    int contradictions;
+    long steps;
+} SolveStats;
+
+static SolveStats _solveStats;
+
+// Clues are derived up front, so only the solver is timed
+static BoardHints *_solveHints;
+static int _numSolveHints;
+static Solver _solver;
+
+static long _benchSolve(BenchCase *bc)
+{
+    (void)bc;
+    memset(&_solveStats, 0, sizeof(SolveStats));
+    for (int b = 0; b < _numSolveHints; b++) {
+        solverReset(&_solver);
+        long steps = _solver.steps;
+        switch (solverSolve(&_solver, &_solveHints[b])) {
+        case SolveResult_Solved:
+            _solveStats.solved++;
+            break;
+        case SolveResult_Stuck:
+            _solveStats.stuck++;
+            break;
+        default:
+            _solveStats.contradictions++;
+            break;
+        }
+        _solveStats.steps += _solver.steps - steps;
+    }
+    return _numSolveHints;
+}
+
+// Random boards mostly get stuck after a few sweeps, which leaves most of the
+// solver untimed, so it runs on boards the generator made sure line solving
+// finishes. Boards it doesn't find within BENCH_SOLVE_ATTEMPTS are left out.
+static bool _createSolveHints(BenchOptions *options, int size, int count)
+{
+    GeneratorOptions genOptions;
+    genOptions.size = size;
+    genOptions.density = options->solveDensity;
+    genOptions.difficulty = GeneratorDifficulty_Any;
+    genOptions.seed = options->seed ^ ((uint64_t)size * 0xd1b54a32d192ed03ull);
+    genOptions.maxAttempts = BENCH_SOLVE_ATTEMPTS;
+    genOptions.numThreads = 0;
+
+    GeneratedLevels levels;
+    if (!generatorRun(&genOptions, count, &levels))
+        return false;
+    _solveHints = (BoardHints *)calloc(count, sizeof(BoardHints));
+    bool ok = _solveHints != NULL;
+    for (int i = 0; ok && i < count; i++) {
+        if (!levels.found[i])
+            continue;
+        Board board;
+        ok = generatorLoadLevel(&levels, i, &board);
+        if (ok) {
+            ok = hintsCreate(&_solveHints[_numSolveHints], &board);
+            boardDestroy(&board);
+        }
+        if (ok)
+            _numSolveHints++;
+    }
+    generatorDestroy(&levels);
+    return ok;
+}
+
+typedef struct s_bench {
+    const char *name;
+    const char *unit; // what one op is
+    long (*run)(BenchCase *bc);
+} Bench;
+
+static const Bench _benches[] = {
+    {"boardLoadBuffer", "board", _benchLoad},
+    {"boardIsSolved", "call", _benchIsSolved},
+    {"boardMatchesSolution", "board", _benchMatchesSolution},
+    {"hintsCreate", "board", _benchHints},
+    {"boardSetCell", "call", _benchSetCell}, // leaves the board scrambled
+    {"clueStateUpdate", "move", _benchClueUpdate},
+    {"solverSolve", "board", _benchSolve},
+};
+
+// Runs a benchmark repeat times and writes one JSON object with the median
+// and fastest rep. Returns the median in nanoseconds per op.
+static double _runBench(FILE *fp, const Bench *bench, BenchCase *bc, int repeat, bool *first)
+{
+    double nsPerOp[BENCH_MAX_REPEAT];
+    long ops = 0;
+    bench->run(bc); // warm up caches and the allocator
+    for (int r = 0; r < repeat; r++) {
+        uint64_t start = monotonicNs();
+        ops = bench->run(bc);
+        nsPerOp[r] = (double)(monotonicNs() - start) / ops;
+    }
+    qsort(nsPerOp, repeat, sizeof(double), _compareDoubles);
+    double median = repeat % 2 ? nsPerOp[repeat / 2] : (nsPerOp[repeat / 2 - 1] + nsPerOp[repeat / 2]) / 2.0;
+
+    fprintf(fp, "%s\n    {\"name\":\"%s\",\"size\":%d,\"unit\":\"%s\",\"opsPerRep\":%ld", *first ? "" : ",", bench->name, bc->size, bench->unit, ops);
+    fprintf(fp, ",\"medianNs\":%.3f,\"minNs\":%.3f,\"maxNs\":%.3f,\"opsPerSec\":%.1f", median, nsPerOp[0], nsPerOp[repeat - 1], median > 0.0 ? 1e9 / median : 0.0);
+    if (bench->run == _benchLoad)
+        fprintf(fp, ",\"mbPerSec\":%.1f", median > 0.0 ? bc->textLen / median * 1e3 : 0.0);
+    else if (bench->run == _benchSolve)
+        fprintf(fp, ",\"solved\":%d,\"stuck\":%d,\"contradictions\":%d,\"stepsPerBoard\":%.1f", _solveStats.solved, _solveStats.stuck,
+            _solveStats.contradictions, (double)_solveStats.steps / _numSolveHints);
+    fprintf(fp, "}");
+    *first = false;
+    return median;
+}
+
+static bool _runSize(FILE *fp, BenchOptions *options, int size, bool *first)
+{
+    BenchCase bc;
+    bool ok = _createCase(&bc, options, size) && solverCreate(&_solver, size);
+    ok = ok && _createSolveHints(options, size, bc.numBoards);
+    ok = ok && hintsCreate(&_clueHints, &bc.board);
+    ok = ok && clueStateStart(&_clues, &bc.board, &_clueHints);
+
+    if (ok) {
+        for (size_t i = 0; i < sizeof(_benches) / sizeof(_benches[0]); i++) {
+            if (_benches[i].run == _benchSolve && _numSolveHints == 0) {
+                fprintf(stderr, "%5dx%-5d %-22s no line solvable boards found\n", size, size, _benches[i].name);
+                continue;
+            }
+            double median = _runBench(fp, &_benches[i], &bc, options->repeat, first);
+            fprintf(stderr, "%5dx%-5d %-22s %14.1f ns/%s\n", size, size, _benches[i].name, median, _benches[i].unit);
+        }
+    } else {
+        fprintf(stderr, "Failed to set up %dx%d boards\n", size, size);
+    }
+
+    for (int i = 0; i < _numSolveHints; i++)
+        hintsDestroy(&_solveHints[i]);
+    free(_solveHints);
+    _solveHints = NULL;
+    _numSolveHints = 0;
+    if (_clueHints.data)
+        hintsDestroy(&_clueHints);
+    memset(&_clueHints, 0, sizeof(BoardHints));
+    clueStateDestroy(&_clues);
+    if (_solver.grid)
+        solverDestroy(&_solver);
+    memset(&_solver, 0, sizeof(Solver));
+    _destroyCase(&bc);
+    return ok;
+}
+
+static void _printUsage(const char *name)
+{
+    printf("pikurosu_bench - Pikurosu microbenchmarks\nUsage: %s [options]\n", name);
+    printf("\n --output [file] - write the JSON results to a file instead of stdout\n");
+    printf(" --repeat [n] - timed reps per benchmark, the median is reported (default 5, at most %d)\n", BENCH_MAX_REPEAT);
+    printf(" --max-size [n] - skip board sizes above n (default 1000)\n");
+    printf(" --seed [n] - random seed for the boards (default 1)\n");
+    printf(" --density [0-1] - chance of a cell being filled (default 0.65)\n");
+    printf(" --solve-density [0-1] - the same for the line solvable boards solverSolve runs on (default 0.8)\n");
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    options.seed = 1;
+    options.density = 0.65;
+    options.solveDensity = 0.8;
+    options.repeat = 5;
+    options.maxSize = 1000;
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--output") == 0 && hasValue) {
+            output = argv[++i];
+        } else if (strcmp(arg, "--repeat") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.repeat = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-size") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.maxSize = atoi(argv[++i]);
+        } else if (strcmp(arg, "--seed") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--density") == 0 && hasValue) {
+            options.density = atof(argv[++i]);
+        } else if (strcmp(arg, "--solve-density") == 0 && hasValue) {
+            options.solveDensity = atof(argv[++i]);
+        } else {
+            _printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.repeat < 1 || options.repeat > BENCH_MAX_REPEAT || options.density <= 0.0 || options.density > 1.0
+        || options.solveDensity <= 0.0 || options.solveDensity > 1.0) {
+        _printUsage(argv[0]);
+        return 1;
+    }
+
+    mtnlogInit(MTNLOG_WARNING, "pikurosu_bench.log");
+
+    FILE *fp = output ? fopen(output, "w") : stdout;
+    if (!fp) {
+        fprintf(stderr, "%s: can't open output file\n", output);
+        return 1;
+    }
+    fprintf(fp, "{\"suite\":\"pikurosu_bench\",\"version\":\"%d.%d.%d\",\"compiler\":\"%s\"", PIKUROSU_MAJOR, PIKUROSU_MINOR, PIKUROSU_PATCH,
+#ifdef __VERSION__
+        __VERSION__
+#else
+        "unknown"
+#endif
+    );
+    fprintf(fp, ",\"seed\":%llu,\"density\":%.3f,\"solveDensity\":%.3f,\"repeat\":%d,\"results\":[", (unsigned long long)options.seed, options.density,
+        options.solveDensity, options.repeat);
+
+    bool first = true;
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(_sizes) / sizeof(_sizes[0]); i++) {
+        if (_sizes[i] <= options.maxSize)
+            ok = _runSize(fp, &options, _sizes[i], &first) && ok;
+    }
+    fprintf(fp, "\n]}\n");
+
+    ok = (fp == stdout ? fflush(fp) == 0 : fclose(fp) == 0) && ok;
+    return ok ? 0 : 1;
+}
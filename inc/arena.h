@@ -0,0 +1,32 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK (64 * 1024)
+
+typedef struct s_arena_block {
+    struct s_arena_block *prev;
+    size_t size; // bytes after the header
+    size_t used;
+} ArenaBlock;
+
+// Bump allocator for memory that is all freed at once. When the current block
+// is full a bigger one is chained on, and arenaReset merges the chain into a
+// single block of the combined size, so after the largest load so far every
+// load fits in one block and allocates nothing.
+typedef struct s_arena {
+    ArenaBlock *block; // newest block, older ones hang off prev
+} Arena;
+
+void arenaInit(Arena *arena);
+void arenaDestroy(Arena *arena);
+void arenaReset(Arena *arena);
+
+void *arenaAlloc(Arena *arena, size_t size);
+char *arenaStrndup(Arena *arena, const char *str, size_t len);
+size_t arenaUsed(Arena *arena);
+
+#endif
@@ -11,10 +11,22 @@ typedef enum e_argpres {
     ArgParseResult_HelpCommand
 } ArgParseResult;
 
+typedef enum e_batch_mode {
+    BatchMode_None,
+    BatchMode_Solve,
+    BatchMode_Verify
+} BatchMode;
+
 ArgParseResult argsParse(int argc, char **argv);
 int argsGetScreenWidth(void);
 int argsGetScreenHeight(void);
 bool argsGetFullscreen(void);
+BatchMode argsGetBatchMode(void);
+const char *argsGetBatchSource(void);
+const char *argsGetBatchOutput(void);
+int argsGetThreads(void);
+const char *argsGetTraceFile(void);
+const char *argsGetRecordFile(void);
 void argsCleanup(void);
 
 #endif
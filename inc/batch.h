@@ -0,0 +1,10 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "args.h"
+
+// Solves every level in a directory or pack without touching SDL and writes
+// one JSON object per level to output. Returns the process exit code.
+int batchRun(BatchMode mode, const char *source, const char *output, int numThreads);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef BITSET_H_
+#define BITSET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BITSET_WORDS(bits) (((bits) + 63) / 64)
+
+static inline bool bitsetGet(const uint64_t *set, int i)
+{
+    return (set[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bitsetSet(uint64_t *set, int i)
+{
+    set[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void bitsetClear(uint64_t *set, int i)
+{
+    set[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef BOARD_H_
 #define BOARD_H_
 
+#include "arena.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define BOARD_MAX_SIZE 4096
 
 typedef enum e_cell_state {
     CellState_Empty,
@@ -9,21 +14,73 @@ typedef enum e_cell_state {
     CellState_Cross,
 } CellState;
 
+// Cells are stored as bitsets, one per row (x is the bit index) plus a
+// transposed copy with one bitset per column (y is the bit index). Every line
+// takes wordsPerLine words and the padding bits are always zero.
+//
+// A cell is a mismatch when it is filled but shouldn't be or the other way
+// around. boardSetCell keeps the mismatch counts up to date so the solved
+// state never needs a full scan.
+//
+// Boards loaded with an arena keep all their memory in it and boardDestroy
+// only forgets it, the arena's owner frees it all at once.
 typedef struct s_board {
-    CellState *cells;
-    CellState *solved;
+    uint64_t *filled;
+    uint64_t *crosses;
+    uint64_t *filledCols;
+    uint64_t *crossCols;
+    uint64_t *solved;
+    uint64_t *solvedCols;
+    int *rowMismatches;
+    int *colMismatches;
+    int mismatches;
+    int wrongRows;
+    int wrongCols;
     int size;
+    int wordsPerLine;
+    Arena *arena; // NULL if the memory is on the heap
 } Board;
 
 typedef struct s_board_meta {
     char *name;
     char *author;
+    Arena *arena; // same as Board::arena
 } BoardMetadata;
 
-void boardCreate(Board *board, int size);
-void boardLoad(Board *board, BoardMetadata *boardMeta, const char *name);
-void boardLoadMeta(BoardMetadata *meta, int *size, const char *name);
-void boardLoadSolution(Board *board, const char *name);
+typedef enum e_board_load_result {
+    BoardLoadResult_OK,
+    BoardLoadResult_OpenError,
+    BoardLoadResult_AllocationError,
+    BoardLoadResult_MissingSize,
+    BoardLoadResult_InvalidSize,
+    BoardLoadResult_MissingSolution,
+    BoardLoadResult_BadRowWidth,
+    BoardLoadResult_BadCell,
+    BoardLoadResult_TooManyRows,
+    BoardLoadResult_TooFewRows
+} BoardLoadResult;
+
+typedef struct s_board_load_error {
+    BoardLoadResult result;
+    int line; // 1-based line where parsing stopped
+    int column; // 1-based column of the offending character, 0 if none
+    int unknownLines; // metadata lines that were skipped
+} BoardLoadError;
+
+bool boardCreate(Board *board, int size);
+bool boardLoad(Board *board, BoardMetadata *boardMeta, const char *name, BoardLoadError *err);
+bool boardLoadArena(Board *board, BoardMetadata *boardMeta, const char *name, BoardLoadError *err, Arena *arena);
+bool boardLoadBuffer(Board *board, BoardMetadata *boardMeta, const char *buf, size_t len, BoardLoadError *err);
+bool boardLoadBufferArena(Board *board, BoardMetadata *boardMeta, const char *buf, size_t len, BoardLoadError *err, Arena *arena);
+bool boardLoadMeta(BoardMetadata *meta, int *size, const char *name, BoardLoadError *err);
+bool boardLoadMetaBuffer(BoardMetadata *meta, int *size, const char *buf, size_t len, BoardLoadError *err);
+const char *boardLoadResultString(BoardLoadResult result);
+bool boardSave(Board *board, BoardMetadata *meta, const char *name);
+
+bool boardLoadPacked(Board *board, const unsigned char *bits, int size);
+bool boardLoadPackedArena(Board *board, const unsigned char *bits, int size, Arena *arena);
+size_t boardPackedSize(int size);
+void boardPackSolution(Board *board, unsigned char *bits);
 
 CellState boardGetCell(Board *board, int x, int y);
 void boardSetCell(Board *board, int x, int y, CellState state);
@@ -32,5 +89,14 @@ void boardDestroy(Board *board);
 void boardMetaDestroy(BoardMetadata *board);
 
 bool boardIsSolved(Board *board);
+bool boardMatchesSolution(Board *board);
+int boardCountMismatches(Board *board);
+void boardResetMismatches(Board *board);
+
+int boardCellsLeft(Board *board);
+int boardRowMismatches(Board *board, int y);
+int boardColMismatches(Board *board, int x);
+int boardWrongRows(Board *board);
+int boardWrongCols(Board *board);
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef BOARDRENDER_H_
+#define BOARDRENDER_H_
+
+#include "board.h"
+#include "camera.h"
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define BOARDRENDER_LOD_CELL_SIZE 8 // smaller cells get drawn from a texture
+
+// Draws a board with a handful of batched calls per frame instead of a few per
+// cell. The rect and vertex batches only cover the cells on screen and are
+// only rebuilt after boardRendererInvalidate or when the camera moves; hover
+// highlights are drawn on top every frame. Under a clip rect only the parts of
+// the batches that reach into it get drawn. Zoomed far out the board is a
+// streaming texture with one texel per cell instead.
+typedef struct s_board_renderer {
+    SDL_Rect *gridRects;
+    int numGridRects;
+    int gridCap;
+
+    SDL_Rect *filledRects;
+    int numFilled;
+    int filledCap;
+
+    SDL_Point *crossCells; // top left corner of every crossed cell
+    SDL_Vertex *crossVerts;
+    int *crossIndices;
+    int numCrosses;
+    int crossCap;
+
+    int boardX;
+    int boardY;
+    int cellSize;
+    int size;
+    SDL_Rect cells; // visible cells the batches were built for
+    bool dirty;
+
+    SDL_Texture *lodTexture;
+    int lodSize;
+    int lodDirtyMin; // rows that changed since the last upload
+    int lodDirtyMax;
+} BoardRenderer;
+
+void boardRendererInit(BoardRenderer *renderer);
+void boardRendererDestroy(BoardRenderer *renderer);
+void boardRendererInvalidate(BoardRenderer *renderer);
+void boardRendererInvalidateCell(BoardRenderer *renderer, int x, int y);
+void boardRendererResetTextures(BoardRenderer *renderer);
+// hoverX and hoverY are the hovered cell, or -1 when the mouse isn't on the
+// board
+void boardRendererDraw(BoardRenderer *renderer, SDL_Renderer *rend, Board *board, const Camera *camera, int hoverX, int hoverY);
+
+#endif
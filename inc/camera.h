@@ -0,0 +1,33 @@
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define CAMERA_FIT_CELL_SIZE 32 // largest cell size a fresh board gets
+#define CAMERA_PAN_MARGIN 40 // pixels of a large board that always stay on screen
+
+// Maps board cells to the screen. The board's top left corner can be
+// anywhere, including off screen, and cells are cellSize pixels at one of a
+// few fixed zoom levels. The clues take clueW cells left of the board and
+// clueH cells above it, fitting and clamping treat them as part of the board.
+typedef struct s_camera {
+    int boardX;
+    int boardY;
+    int cellSize;
+    int zoom; // index into the zoom levels
+    int boardSize;
+    int clueW;
+    int clueH;
+    int viewW;
+    int viewH;
+} Camera;
+
+void cameraFit(Camera *camera, int boardSize, int clueW, int clueH, int viewW, int viewH);
+void cameraSetView(Camera *camera, int viewW, int viewH);
+bool cameraZoom(Camera *camera, int steps, int anchorX, int anchorY);
+bool cameraPan(Camera *camera, int dx, int dy);
+SDL_Rect cameraVisibleCells(const Camera *camera);
+bool cameraCellAt(const Camera *camera, int screenX, int screenY, int *x, int *y);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+#include "board.h"
+#include "hints.h"
+#include "level.h"
+#include "pack.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CATALOG_MAGIC "PIKC"
+#define CATALOG_VERSION 1
+
+// One playable level: a .pikurosu file or one level inside a pack
+typedef struct s_catalog_entry {
+    char *file; // file name inside the catalog directory
+    char *name;
+    char *author;
+    int64_t mtime;
+    int64_t fileSize;
+    int packIndex; // -1 for plain level files
+    int boardSize;
+    bool metaLoaded;
+} CatalogEntry;
+
+// Level metadata is kept in a cache file keyed by file name, mtime and size.
+// On load only new or changed files are looked at again, and plain level
+// files only get parsed when their metadata is first asked for. Without a
+// cache file every load starts from scratch.
+typedef struct s_catalog {
+    CatalogEntry *entries;
+    int numEntries;
+    int cap;
+    char *dir;
+    char *cacheFile;
+    bool dirty;
+    Pack pack; // pack used by the last catalogLoadLevel, kept mapped
+    char *packFile;
+} Catalog;
+
+bool catalogLoad(Catalog *catalog, const char *dir, const char *cacheFile);
+bool catalogSave(Catalog *catalog);
+void catalogDestroy(Catalog *catalog);
+
+int catalogGetNumEntries(Catalog *catalog);
+CatalogEntry *catalogGetEntry(Catalog *catalog, int index);
+char *catalogGetPath(Catalog *catalog, int index);
+// Safe on another thread while the catalog is used elsewhere, as long as only
+// one thread loads levels
+bool catalogLoadLevel(Catalog *catalog, int index, Level *level);
+
+#endif
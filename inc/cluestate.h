@@ -0,0 +1,32 @@
+#ifndef CLUESTATE_H_
+#define CLUESTATE_H_
+
+#include "board.h"
+#include "hints.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Which clues the player has placed. A clue is done when its run of the
+// solution is filled and the cells on either side of it aren't. done is laid
+// out like BoardHints::data, so the flag of clue i of line l is at
+// hints->lines[l] + 1 + i and the count slots are unused.
+//
+// The flags are only computed for every line once in clueStateStart, after
+// that clueStateUpdate evaluates the row and column of a changed cell and
+// nothing else.
+typedef struct s_clue_state {
+    Board *board;
+    BoardHints *hints;
+    bool *done;
+    size_t cap; // flags done has room for, kept between levels
+} ClueState;
+
+void clueStateInit(ClueState *state);
+void clueStateDestroy(ClueState *state);
+bool clueStateStart(ClueState *state, Board *board, BoardHints *hints);
+bool clueStateUpdate(ClueState *state, int x, int y);
+
+const bool *clueStateGetRow(ClueState *state, int y);
+const bool *clueStateGetCol(ClueState *state, int x);
+
+#endif
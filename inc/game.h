@@ -6,6 +6,6 @@ typedef enum e_gamestate {
     GameState_LevelSelect
 } GameState;
 
-void gameRun(int argc, char **argv);
+void gameRun(void);
 
 #endif
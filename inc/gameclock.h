@@ -0,0 +1,44 @@
+#ifndef GAMECLOCK_H_
+#define GAMECLOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FRAME_STATS_SAMPLES 128
+
+// Stopwatch on top of monotonicNs. Elapsed time comes from timestamps, so it
+// doesn't drift no matter how rarely it's looked at.
+typedef struct s_game_clock {
+    uint64_t startNs; // when the clock last started or resumed
+    uint64_t elapsedNs; // time accumulated before the last pause
+    uint64_t lapNs; // elapsed time at the last lap
+    bool running;
+} GameClock;
+
+// Durations of the last FRAME_STATS_SAMPLES frames
+typedef struct s_frame_stats {
+    uint64_t samples[FRAME_STATS_SAMPLES];
+    int numSamples;
+    int next;
+    uint64_t frameStartNs;
+    long numFrames;
+} FrameStats;
+
+void gameClockStart(GameClock *clock);
+void gameClockStop(GameClock *clock);
+void gameClockPause(GameClock *clock);
+void gameClockResume(GameClock *clock);
+bool gameClockIsRunning(GameClock *clock);
+uint64_t gameClockElapsedNs(GameClock *clock);
+int64_t gameClockElapsedMs(GameClock *clock);
+uint64_t gameClockLap(GameClock *clock);
+
+void frameStatsInit(FrameStats *stats);
+void frameStatsBegin(FrameStats *stats);
+void frameStatsEnd(FrameStats *stats);
+double frameStatsAverageMs(FrameStats *stats);
+double frameStatsMaxMs(FrameStats *stats);
+double frameStatsLastMs(FrameStats *stats);
+double frameStatsPercentileMs(FrameStats *stats, double percentile);
+
+#endif
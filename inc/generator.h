@@ -0,0 +1,44 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include "board.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Difficulty is measured by how many line solves the solver needs per line
+typedef enum e_generator_difficulty {
+    GeneratorDifficulty_Any,
+    GeneratorDifficulty_Easy,
+    GeneratorDifficulty_Medium,
+    GeneratorDifficulty_Hard
+} GeneratorDifficulty;
+
+typedef struct s_generator_options {
+    int size;
+    double density; // chance of a cell being filled
+    GeneratorDifficulty difficulty;
+    uint64_t seed;
+    int maxAttempts; // candidates tried per level before giving up on it
+    int numThreads; // 0 for one per core
+} GeneratorOptions;
+
+// Generated solutions, packed like boardPackSolution. Level i only exists if
+// found[i] is set.
+typedef struct s_generated_levels {
+    unsigned char *bits;
+    bool *found;
+    int count;
+    int size;
+    long attempts; // candidates tried in total
+} GeneratedLevels;
+
+// Samples random grids until every level has one whose clues can be line
+// solved, which also means the solution is unique. Level i only depends on the
+// seed and i, not on the number of threads.
+bool generatorRun(GeneratorOptions *options, int count, GeneratedLevels *levels);
+bool generatorLoadLevel(GeneratedLevels *levels, int index, Board *board);
+void generatorDestroy(GeneratedLevels *levels);
+
+const char *generatorDifficultyString(GeneratorDifficulty difficulty);
+
+#endif
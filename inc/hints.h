@@ -1,18 +1,35 @@
 #ifndef HINTS_H_
 #define HINTS_H_
 
-#include <math.h>
+#include "arena.h"
+#include "board.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
-#define MAX_HINTS(boardSize) (int)(ceil((boardSize) / 2.0) - 1)
+// a line of n cells has at most one block on every other cell
+#define MAX_HINTS(boardSize) (((boardSize) + 1) / 2)
 
+// All clues live in one buffer. lines[i] is the offset in data of row i (or
+// of column i - boardSize), which is stored as the clue count followed by the
+// clues themselves.
 typedef struct s_hints {
-    int **rows;
-    int **cols;
+    int *lines;
+    int *data;
     int boardSize;
+    Arena *arena; // NULL if lines is on the heap
 } BoardHints;
 
-bool hintsCreate(BoardHints *hints, int boardSize);
+bool hintsCreate(BoardHints *hints, Board *board);
+bool hintsCreateArena(BoardHints *hints, Board *board, Arena *arena);
+bool hintsCreateFromPlanes(BoardHints *hints, const uint64_t *rows, const uint64_t *cols, int boardSize);
+bool hintsCreateFromClues(BoardHints *hints, const uint16_t *clues, size_t len, int boardSize);
+bool hintsCreateFromCluesArena(BoardHints *hints, const uint16_t *clues, size_t len, int boardSize, Arena *arena);
+bool hintsMatchBoard(BoardHints *hints, Board *board);
 void hintsDestroy(BoardHints *hints);
 
+const int *hintsGetRow(BoardHints *hints, int y, int *count);
+const int *hintsGetCol(BoardHints *hints, int x, int *count);
+size_t hintsDataSize(BoardHints *hints);
+
 #endif
@@ -0,0 +1,28 @@
+#ifndef LEVEL_H_
+#define LEVEL_H_
+
+#include "arena.h"
+#include "board.h"
+#include "hints.h"
+#include "pack.h"
+#include <stdbool.h>
+
+// A loaded level and everything it owns. The board, its metadata and its clues
+// all come from one arena, so unloading is a single reset and loading the next
+// level allocates nothing unless it's the biggest one yet.
+typedef struct s_level {
+    Arena arena;
+    Board board;
+    BoardMetadata meta;
+    BoardHints hints;
+    bool loaded;
+} Level;
+
+void levelInit(Level *level);
+void levelDestroy(Level *level);
+void levelUnload(Level *level);
+
+bool levelLoadFile(Level *level, const char *name, BoardLoadError *err);
+bool levelLoadPack(Level *level, Pack *pack, int index);
+
+#endif
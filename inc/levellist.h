@@ -0,0 +1,78 @@
+#ifndef LEVELLIST_H_
+#define LEVELLIST_H_
+
+#include "catalog.h"
+#include "SDL_FontCache.h"
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LEVEL_LIST_FILTER_SIZE 64
+#define LEVEL_LIST_CACHE_SIZE 128 // label textures kept around, more than fit on screen
+#define LEVEL_LIST_ROW_HEIGHT 23
+#define LEVEL_LIST_META_BUDGET_MS 4.0 // metadata parsing per frame while sorting or filtering needs it
+
+typedef enum e_level_sort {
+    LevelSort_File,
+    LevelSort_Name,
+    LevelSort_Author,
+    LevelSort_Size,
+} LevelSort;
+
+typedef struct s_level_list_item {
+    CatalogEntry *entry; // NULL until its metadata is loaded
+    int index; // catalog index
+} LevelListItem;
+
+typedef struct s_level_label {
+    SDL_Texture *texture;
+    int index; // catalog index, -1 for a free slot
+    int w;
+    int h;
+    uint64_t lastUsed;
+} LevelLabel;
+
+// Scrollable view over the catalog. Only the rows on screen get laid out and
+// drawn, and their labels are rendered once into textures that stay cached
+// until they're the least recently used. Level metadata is only loaded for
+// every entry once something sorts or filters by it, a few milliseconds per
+// frame in levelListLoadMeta. Until then sorting and filtering work with what
+// is loaded: the other levels sort last and a filter hides them.
+typedef struct s_level_list {
+    Catalog *catalog;
+    LevelListItem *items; // every entry, in sort order
+    int *shown; // indices into items that pass the filter
+    int numShown;
+    char filter[LEVEL_LIST_FILTER_SIZE];
+    LevelSort sort;
+    int selected; // index into shown
+    int first; // first row on screen
+    int numRows; // rows that fit on screen
+    int numMetaLoaded; // items with an entry
+    int metaCursor; // items before it have an entry
+    LevelLabel labels[LEVEL_LIST_CACHE_SIZE];
+    uint64_t useCounter;
+} LevelList;
+
+bool levelListInit(LevelList *list, Catalog *catalog);
+void levelListDestroy(LevelList *list);
+void levelListInvalidate(LevelList *list);
+
+void levelListSetNumRows(LevelList *list, int numRows);
+bool levelListSelect(LevelList *list, int selected);
+bool levelListScroll(LevelList *list, int rows);
+int levelListGetLevel(LevelList *list, int row);
+int levelListGetSelectedLevel(LevelList *list);
+
+bool levelListNeedsMeta(LevelList *list);
+bool levelListLoadMeta(LevelList *list, double budgetMs);
+
+void levelListSetSort(LevelList *list, LevelSort sort);
+void levelListAppendFilter(LevelList *list, const char *text);
+bool levelListBackspace(LevelList *list);
+const char *levelListSortString(LevelSort sort);
+
+void levelListPrepare(LevelList *list, SDL_Renderer *rend, FC_Font *font);
+void levelListDraw(LevelList *list, SDL_Renderer *rend, FC_Font *font, int x, int y);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef LOADER_H_
+#define LOADER_H_
+
+#include "catalog.h"
+#include "level.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOADER_CACHE_SIZE 8 // loaded levels kept around, including the one being played
+#define LOADER_PREFETCH_RADIUS 2 // levels on either side of the selection to load ahead
+
+typedef enum e_loader_slot_state {
+    LoaderSlot_Free,
+    LoaderSlot_Queued,
+    LoaderSlot_Loading, // only the worker touches the level
+    LoaderSlot_Ready,
+    LoaderSlot_Failed
+} LoaderSlotState;
+
+typedef struct s_loader_slot {
+    Level level;
+    int index; // catalog index, -1 for a free slot
+    LoaderSlotState state;
+    bool pinned; // handed out by loaderAcquire
+    bool requested; // waited for since loaderRequest, never evicted until loaderAcquire
+    double loadMs;
+    uint64_t lastUsed;
+} LoaderSlot;
+
+// Loads levels from the catalog on a worker thread into a small LRU of
+// levels, each with its own arena so reloading a slot doesn't allocate.
+// Requests wait in a queue, the level the player asked for goes first and
+// prefetches around the selection go after it. A new prefetch replaces the
+// prefetches that haven't started yet, so scrolling quickly doesn't build up
+// a backlog.
+//
+// The worker is the only one calling catalogLoadLevel while the loader runs.
+// onLoaded is called on the worker after every load, successful or not.
+typedef struct s_loader {
+    Catalog *catalog;
+    LoaderSlot slots[LOADER_CACHE_SIZE];
+    int queue[LOADER_CACHE_SIZE]; // slot indices, next to load first
+    int queueLen;
+    uint64_t useCounter;
+    bool running;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    void (*onLoaded)(void *arg, int index);
+    void *arg;
+} Loader;
+
+bool loaderStart(Loader *loader, Catalog *catalog, void (*onLoaded)(void *arg, int index), void *arg);
+void loaderStop(Loader *loader);
+
+void loaderRequest(Loader *loader, int index);
+void loaderPrefetch(Loader *loader, const int *indices, int count);
+Level *loaderAcquire(Loader *loader, int index, bool *failed, double *loadMs);
+void loaderRelease(Loader *loader, Level *level);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include "mtnlog.h"
+#include <stdbool.h>
+
+// Messages below this level are compiled out
+#ifndef PIKUROSU_LOG_LEVEL
+#define PIKUROSU_LOG_LEVEL MTNLOG_INFO
+#endif
+
+#define LOGGER_QUEUE_SIZE 1024 // must be a power of two
+#define LOGGER_ARG_BYTES 224
+
+// Front end for mtnlog. While the logger runs, LOG_MESSAGE only copies the
+// format string pointer and the raw arguments into a lock-free queue, and a
+// background thread formats them and hands them to mtnlog. When the queue is
+// full the message is dropped and counted instead of waiting. Before
+// loggerStart and after loggerStop messages go straight to mtnlog.
+//
+// The format string and tag must be string literals, %s arguments get copied.
+#define LOG_MESSAGE(level, tag, ...) \
+    do { \
+        if ((level) >= PIKUROSU_LOG_LEVEL) \
+            loggerWrite((level), (tag), __VA_ARGS__); \
+    } while (0)
+
+bool loggerStart(int minLevel);
+void loggerStop(void);
+#if defined(__GNUC__)
+__attribute__((format(printf, 3, 4)))
+#endif
+void loggerWrite(int level, const char *tag, const char *fmt, ...);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef PACK_H_
+#define PACK_H_
+
+#include "board.h"
+#include "hints.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Level packs hold many levels in one file, stored little-endian:
+//
+//   PackHeader
+//   PackEntry[numLevels]
+//   string table (NUL-terminated names and authors)
+//   level data
+//
+// Level data is the bit-packed solution (see boardPackSolution), followed by
+// the clues as uint16 values in BoardHints::data layout if the pack has them.
+
+#define PACK_MAGIC "PIKP"
+#define PACK_VERSION 1
+#define PACK_EXTENSION ".pikpack"
+
+typedef enum e_pack_flags {
+    PackFlags_Hints = 1
+} PackFlags;
+
+typedef struct s_pack_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t numLevels;
+    uint32_t flags;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+} PackHeader;
+
+typedef struct s_pack_entry {
+    uint64_t offset; // start of the level data
+    uint64_t hash; // hash of the board size and packed solution
+    uint32_t dataSize;
+    uint32_t hintsSize; // bytes of clues at the end of the data
+    uint32_t nameOffset; // into the string table
+    uint32_t authorOffset;
+    uint16_t boardSize;
+    uint16_t reserved[3];
+} PackEntry;
+
+typedef struct s_pack {
+    const char *data;
+    size_t len;
+    const PackHeader *header;
+    const PackEntry *entries;
+    const char *strings;
+} Pack;
+
+typedef struct s_pack_writer {
+    PackEntry *entries;
+    int numLevels;
+    int entriesCap;
+    char *strings;
+    size_t stringsSize;
+    size_t stringsCap;
+    unsigned char *levelData;
+    size_t levelDataSize;
+    size_t levelDataCap;
+    bool withHints;
+} PackWriter;
+
+bool packOpen(Pack *pack, const char *name);
+bool packOpenBuffer(Pack *pack, const char *buf, size_t len);
+void packClose(Pack *pack);
+
+int packGetNumLevels(Pack *pack);
+const char *packGetName(Pack *pack, int index);
+const char *packGetAuthor(Pack *pack, int index);
+int packGetBoardSize(Pack *pack, int index);
+uint64_t packGetHash(Pack *pack, int index);
+bool packLoadLevel(Pack *pack, int index, Board *board, BoardMetadata *meta, BoardHints *hints);
+bool packLoadLevelArena(Pack *pack, int index, Board *board, BoardMetadata *meta, BoardHints *hints, Arena *arena);
+
+uint64_t packHashSolution(const unsigned char *bits, int boardSize);
+
+bool packWriterCreate(PackWriter *writer, bool withHints);
+bool packWriterAdd(PackWriter *writer, Board *board, BoardMetadata *meta);
+bool packWriterSave(PackWriter *writer, const char *name);
+void packWriterDestroy(PackWriter *writer);
+
+#endif
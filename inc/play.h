@@ -0,0 +1,60 @@
+#ifndef PLAY_H_
+#define PLAY_H_
+
+#include "board.h"
+#include "camera.h"
+#include "hints.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PLAY_PAN_STEP 64 // pixels per arrow key press
+
+typedef enum e_play_event_type {
+    PlayEvent_MouseMotion = 1,
+    PlayEvent_MouseDown,
+    PlayEvent_MouseUp,
+    PlayEvent_MouseWheel,
+    PlayEvent_KeyDown,
+    PlayEvent_Resize,
+} PlayEventType;
+
+// The parts of an SDL event that matter once a level is loaded. x and y are
+// the mouse position, or the new view size for resizes. value is the button
+// for clicks, the button mask for motion, the wheel's y for the wheel and the
+// key code for keys.
+typedef struct s_play_event {
+    PlayEventType type;
+    int32_t x;
+    int32_t y;
+    int32_t xrel;
+    int32_t yrel;
+    int32_t value;
+} PlayEvent;
+
+// Everything a player does to a board once it's loaded: painting with the
+// mouse, and moving the camera with the mouse and keyboard. Works on
+// PlayEvents instead of SDL events and only needs SDL's headers, so replays
+// can drive it without a window.
+typedef struct s_play {
+    Board *board;
+    BoardHints *hints; // NULL leaves no room for clues
+    Camera camera;
+    bool solved;
+    bool painting; // a drag started on the board and the button is still down
+    int paintButton;
+    CellState paintFrom; // only cells in this state get painted
+    CellState paintTo;
+    int paintX; // last cell the drag painted, can be off the board
+    int paintY;
+    long cellsChanged;
+
+    // both optional
+    void (*onCellChanged)(void *arg, int x, int y);
+    void (*onSolved)(void *arg);
+    void *arg;
+} Play;
+
+void playStart(Play *play, Board *board, BoardHints *hints, int viewW, int viewH);
+bool playHandleEvent(Play *play, const PlayEvent *ev);
+
+#endif
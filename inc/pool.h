@@ -0,0 +1,12 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdbool.h>
+
+// Called once for every task index, worker is the index of the calling thread
+typedef void (*PoolTaskFunc)(void *arg, int task, int worker);
+
+int poolDefaultThreads(void);
+bool poolRun(int numThreads, int numTasks, PoolTaskFunc func, void *arg);
+
+#endif
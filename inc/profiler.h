@@ -0,0 +1,45 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROFILER_RING_SIZE 65536 // events kept per thread, must be a power of two
+#define PROFILER_MAX_THREADS 64
+
+// Names must be string literals or otherwise outlive the profiler
+typedef struct s_profiler_event {
+    const char *name;
+    uint64_t startNs;
+    uint64_t durationNs;
+} ProfilerEvent;
+
+typedef struct s_profiler_scope {
+    const char *name;
+    uint64_t startNs;
+} ProfilerScope;
+
+// Every thread records into its own ring buffer, so recording never takes a
+// lock. Reading is meant for the main thread while workers are idle.
+ProfilerScope profilerBegin(const char *name);
+void profilerEnd(ProfilerScope *scope);
+void profilerCountAlloc(size_t bytes);
+
+uint64_t profilerGetAllocs(void);
+uint64_t profilerGetAllocBytes(void);
+double profilerTotalMs(const char *name, uint64_t sinceNs, int *count);
+bool profilerWriteTrace(const char *name);
+void profilerShutdown(void);
+
+#ifdef PIKUROSU_NO_PROFILER
+#define PROFILE_BEGIN(scope, name) do { } while (0)
+#define PROFILE_END(scope) do { } while (0)
+#define PROFILE_ALLOC(bytes) do { } while (0)
+#else
+#define PROFILE_BEGIN(scope, name) ProfilerScope scope = profilerBegin(name)
+#define PROFILE_END(scope) profilerEnd(&scope)
+#define PROFILE_ALLOC(bytes) profilerCountAlloc(bytes)
+#endif
+
+#endif
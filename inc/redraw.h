@@ -0,0 +1,25 @@
+#ifndef REDRAW_H_
+#define REDRAW_H_
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define REDRAW_MAX_REGIONS 16
+#define REDRAW_PASS_AREA (128 * 128) // pixels a scene pass is worth drawing instead
+
+// Screen regions that changed since the last present. Too many regions turn
+// into a full redraw, since redrawing a region means drawing the whole scene
+// clipped to it. Regions close enough to each other merge into one.
+typedef struct s_redraw {
+    SDL_Rect regions[REDRAW_MAX_REGIONS];
+    int numRegions;
+    bool full;
+} Redraw;
+
+void redrawInit(Redraw *redraw);
+void redrawMarkAll(Redraw *redraw);
+void redrawMark(Redraw *redraw, SDL_Rect rect);
+bool redrawPending(Redraw *redraw);
+void redrawClear(Redraw *redraw);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "board.h"
+#include "play.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define REPLAY_MAGIC "PIKR"
+#define REPLAY_VERSION 2 // bumped whenever recorded clicks would land on other cells
+
+// A recording is a header with the level's solution and the view size, the
+// PlayEvents as a type byte, a varint of milliseconds since the previous event
+// and zigzag varints for the fields, and an end record holding a hash of the
+// final board. Mouse motion comes to about 8 bytes.
+typedef struct s_replay_writer {
+    FILE *fp;
+    uint64_t startNs;
+    uint32_t lastMs;
+    long numEvents;
+} ReplayWriter;
+
+typedef struct s_replay {
+    const unsigned char *data;
+    size_t len;
+    int boardSize;
+    int viewW;
+    int viewH;
+    const unsigned char *solution;
+    const unsigned char *events;
+    const unsigned char *next; // next event to read
+    long numEvents;
+    uint32_t durationMs;
+    uint64_t finalHash;
+    bool finalSolved;
+} Replay;
+
+bool replayWriterOpen(ReplayWriter *writer, const char *name, Board *board, int viewW, int viewH);
+bool replayWriterAdd(ReplayWriter *writer, const PlayEvent *ev);
+bool replayWriterClose(ReplayWriter *writer, Board *board);
+
+bool replayOpen(Replay *replay, const char *name);
+void replayClose(Replay *replay);
+bool replayLoadBoard(Replay *replay, Board *board);
+void replayRewind(Replay *replay);
+bool replayNext(Replay *replay, PlayEvent *ev, uint32_t *deltaMs);
+
+uint64_t replayBoardHash(Board *board);
+
+#endif
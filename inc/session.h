@@ -0,0 +1,49 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include "board.h"
+#include "hints.h"
+#include "pack.h"
+#include "solver.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum e_session_move_result {
+    SessionMoveResult_OK,
+    SessionMoveResult_Solved, // this move solved the board
+    SessionMoveResult_AlreadySolved, // the board doesn't change after it's solved
+    SessionMoveResult_OutOfBounds,
+    SessionMoveResult_BadState,
+    SessionMoveResult_NotLoaded
+} SessionMoveResult;
+
+// One puzzle being played: the board and everything derived from it, with no
+// SDL and no shared state. Sessions are independent of each other, so any
+// number of them can be used from different threads at once, but a single
+// session isn't locked and should only be used by one thread at a time.
+// Packs are only read after packOpen, so one pack can feed sessions on every
+// thread.
+typedef struct s_session {
+    Board board;
+    BoardMetadata meta;
+    BoardHints hints; // created on first use unless the pack had them
+    Solver solver; // created by the first sessionSolve
+    bool loaded;
+    bool hasHints;
+    bool hasSolver;
+    long moves; // moves that changed a cell
+} Session;
+
+bool sessionLoad(Session *session, const char *buf, size_t len, BoardLoadError *err);
+bool sessionLoadPacked(Session *session, const unsigned char *bits, int size);
+bool sessionLoadPack(Session *session, Pack *pack, int index);
+void sessionDestroy(Session *session);
+
+SessionMoveResult sessionApplyMove(Session *session, int x, int y, CellState state);
+bool sessionIsSolved(Session *session);
+const BoardHints *sessionGetHints(Session *session);
+SolveResult sessionSolve(Session *session);
+
+const char *sessionMoveResultString(SessionMoveResult result);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SOLVER_H_
+#define SOLVER_H_
+
+#include "board.h"
+#include "hints.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum e_solve_result {
+    SolveResult_Solved,
+    SolveResult_Stuck, // line solving alone can't get any further
+    SolveResult_Contradiction,
+    SolveResult_AllocationError
+} SolveResult;
+
+typedef enum e_unique_result {
+    UniqueResult_Unique,
+    UniqueResult_Multiple,
+    UniqueResult_NoSolution,
+    UniqueResult_Unknown, // gave up after the search budget ran out
+    UniqueResult_AllocationError
+} UniqueResult;
+
+// Earlier line solves, keyed by line and cells. Probes keep solving the same
+// lines from the same cells, so solverCheckUnique keeps one for its search.
+typedef struct s_line_cache_entry {
+    uint64_t hash; // 0 for an unused slot
+    int line;
+    int result; // what solving the line returned
+} LineCacheEntry;
+
+// Cells in the solver grid use CellState values: Empty means unknown,
+// Filled means known filled and Cross means known empty.
+typedef struct s_solver {
+    unsigned char *grid;
+    unsigned char *line;
+    unsigned char *canEmpty;
+    unsigned char *open;
+    unsigned char *fwd;
+    unsigned char *bwd;
+    int *emptyPrefix;
+    int *fill;
+    int *queue;
+    bool *queued;
+    int queueHead;
+    int queueLen;
+    int size;
+    int unknown;
+    long steps; // number of line solves performed
+    long probes; // number of probes and branches tried by solverCheckUnique
+    LineCacheEntry *cache; // only set during solverCheckUnique
+    unsigned char *cacheCells; // 2 * size per entry, the line before and after solving it
+    int cacheSlots;
+} Solver;
+
+bool solverCreate(Solver *solver, int size);
+void solverDestroy(Solver *solver);
+
+void solverLoadBoard(Solver *solver, Board *board);
+void solverReset(Solver *solver);
+SolveResult solverSolve(Solver *solver, BoardHints *hints);
+
+CellState solverGetCell(Solver *solver, int x, int y);
+bool solverMatchesSolution(Solver *solver, Board *board);
+
+UniqueResult solverCheckUnique(Solver *solver, BoardHints *hints, long maxProbes, unsigned char *first, unsigned char *second);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef TEXTCACHE_H_
+#define TEXTCACHE_H_
+
+#include "SDL_FontCache.h"
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#define TEXT_CACHE_SIZE 32
+#define TEXT_CACHE_MAX_LEN 128 // longer strings skip the cache
+
+typedef struct s_text_cache_entry {
+    SDL_Texture *texture;
+    int texW; // texture size, can be larger than the text in it
+    int texH;
+    int w;
+    int h;
+    char text[TEXT_CACHE_MAX_LEN];
+    float scale;
+    SDL_Color color;
+    uint64_t lastUsed;
+} TextCacheEntry;
+
+// Renders strings to textures once and copies them on later draws, keyed by
+// the formatted string, scale and color. When a string changes it replaces
+// the least recently used entry, reusing its texture if the text fits.
+typedef struct s_text_cache {
+    TextCacheEntry entries[TEXT_CACHE_SIZE];
+    FC_Font *font;
+    uint64_t useCounter;
+} TextCache;
+
+void textCacheInit(TextCache *cache, FC_Font *font);
+void textCacheDestroy(TextCache *cache);
+void textCacheInvalidate(TextCache *cache);
+#if defined(__GNUC__)
+__attribute__((format(printf, 7, 8)))
+#endif
+SDL_Rect textCacheDraw(TextCache *cache, SDL_Renderer *rend, int x, int y, float scale, SDL_Color color, const char *fmt, ...);
+
+#endif
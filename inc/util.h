@@ -2,8 +2,17 @@
 #define UTILS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_SEED 0xcbf29ce484222325ull
 
 void sleepMs(int ms);
+uint64_t monotonicNs(void);
 bool isNumberStr(const char *str);
 
+const char *mapFile(const char *name, size_t *len);
+void unmapFile(const char *buf, size_t len);
+uint64_t hashBytes(const void *data, size_t len, uint64_t hash);
+
 #endif
@@ -0,0 +1,95 @@
+#include "arena.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static ArenaBlock *_newBlock(ArenaBlock *prev, size_t size)
+{
+    ArenaBlock *block = (ArenaBlock *)malloc(HEADER_SIZE + size);
+    if (!block) {
+        LOG_MESSAGE(MTNLOG_ERROR, "arena", "Failed to allocate %zu byte block", size);
+        return NULL;
+    }
+    block->prev = prev;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+static void _freeBlocks(ArenaBlock *block)
+{
+    while (block) {
+        ArenaBlock *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
+void arenaInit(Arena *arena)
+{
+    arena->block = NULL;
+}
+
+void arenaDestroy(Arena *arena)
+{
+    _freeBlocks(arena->block);
+    arena->block = NULL;
+}
+
+// Forgets everything allocated so far. Only allocates when the last load
+// didn't fit in one block.
+void arenaReset(Arena *arena)
+{
+    ArenaBlock *block = arena->block;
+    if (!block)
+        return;
+    if (!block->prev) {
+        block->used = 0;
+        return;
+    }
+
+    size_t total = 0;
+    for (ArenaBlock *b = block; b; b = b->prev)
+        total += b->size;
+    _freeBlocks(block);
+    arena->block = _newBlock(NULL, total);
+}
+
+// Returns zeroed memory, aligned to ARENA_ALIGN
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *block = arena->block;
+    if (!block || block->size - block->used < size) {
+        size_t blockSize = block ? block->size * 2 : ARENA_MIN_BLOCK;
+        if (blockSize < size)
+            blockSize = size;
+        block = _newBlock(block, blockSize);
+        if (!block)
+            return NULL;
+        arena->block = block;
+    }
+
+    void *ptr = (unsigned char *)block + HEADER_SIZE + block->used;
+    block->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+char *arenaStrndup(Arena *arena, const char *str, size_t len)
+{
+    char *copy = (char *)arenaAlloc(arena, len + 1);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+size_t arenaUsed(Arena *arena)
+{
+    size_t used = 0;
+    for (ArenaBlock *b = arena->block; b; b = b->prev)
+        used += b->used;
+    return used;
+}
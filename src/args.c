@@ -7,6 +7,12 @@
 static int _screenWidth = 800;
 static int _screenHeight = 600;
 static bool _fullscreen = false;
+static BatchMode _batchMode = BatchMode_None;
+static const char *_batchSource = NULL;
+static const char *_batchOutput = "pikurosu-results.jsonl";
+static int _threads = 0;
+static const char *_traceFile = NULL;
+static const char *_recordFile = NULL;
 
 ArgParseResult argsParse(int argc, char **argv)
 {
@@ -18,7 +24,13 @@ ArgParseResult argsParse(int argc, char **argv)
             printf("\nValid options are:\n");
             printf(" --scrWidth [screen width] - set window width\n");
             printf(" --scrHeight [screen height] - set window height\n");
-            printf(" --fullscreen - enable fullscreen");
+            printf(" --fullscreen - enable fullscreen\n");
+            printf(" --solve [dir or pack] - solve every level without opening a window\n");
+            printf(" --verify [dir or pack] - like --solve, but fail unless every level is uniquely solvable and matches its solution\n");
+            printf(" --output [file] - where --solve and --verify write their results (default pikurosu-results.jsonl)\n");
+            printf(" --threads [count] - number of worker threads (default: one per core)\n");
+            printf(" --trace [file] - write a Chrome trace of the session on exit\n");
+            printf(" --record [file] - record the played level's input for pikreplay\n");
             return ArgParseResult_HelpCommand;
         } else if (strcmp(arg, "--scrWidth") == 0) {
             // screen width
@@ -38,6 +50,38 @@ ArgParseResult argsParse(int argc, char **argv)
             _screenHeight = atoi(shs);
         } else if (strcmp(arg, "--fullscreen") == 0) {
             _fullscreen = true;
+        } else if (strcmp(arg, "--solve") == 0 || strcmp(arg, "--verify") == 0) {
+            // headless batch mode
+            if (i + 1 >= argc) {
+                printf("Missing level directory or pack for %s\n", arg);
+                return ArgParseResult_InvalidArgument;
+            }
+            _batchMode = strcmp(arg, "--solve") == 0 ? BatchMode_Solve : BatchMode_Verify;
+            _batchSource = argv[++i];
+        } else if (strcmp(arg, "--output") == 0) {
+            if (i + 1 >= argc) {
+                printf("Missing output file\n");
+                return ArgParseResult_InvalidArgument;
+            }
+            _batchOutput = argv[++i];
+        } else if (strcmp(arg, "--threads") == 0) {
+            if (i + 1 >= argc || !isNumberStr(argv[i + 1]) || atoi(argv[i + 1]) <= 0) {
+                printf("Invalid thread count\n");
+                return ArgParseResult_InvalidArgument;
+            }
+            _threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--trace") == 0) {
+            if (i + 1 >= argc) {
+                printf("Missing trace file\n");
+                return ArgParseResult_InvalidArgument;
+            }
+            _traceFile = argv[++i];
+        } else if (strcmp(arg, "--record") == 0) {
+            if (i + 1 >= argc) {
+                printf("Missing recording file\n");
+                return ArgParseResult_InvalidArgument;
+            }
+            _recordFile = argv[++i];
         }
     }
 
@@ -59,6 +103,36 @@ bool argsGetFullscreen(void)
     return _fullscreen;
 }
 
+BatchMode argsGetBatchMode(void)
+{
+    return _batchMode;
+}
+
+const char *argsGetBatchSource(void)
+{
+    return _batchSource;
+}
+
+const char *argsGetBatchOutput(void)
+{
+    return _batchOutput;
+}
+
+int argsGetThreads(void)
+{
+    return _threads;
+}
+
+const char *argsGetTraceFile(void)
+{
+    return _traceFile;
+}
+
+const char *argsGetRecordFile(void)
+{
+    return _recordFile;
+}
+
 void argsCleanup(void)
 {
     // (stub)
@@ -0,0 +1,327 @@
+#include "batch.h"
+#include "catalog.h"
+#include "pack.h"
+#include "pool.h"
+#include "solver.h"
+#include "util.h"
+#include "mtnlog.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// how hard the uniqueness check tries on levels line solving can't finish
+#define BATCH_MAX_PROBES 200000
+
+typedef enum e_batch_status {
+    BatchStatus_LoadError,
+    BatchStatus_Solved,
+    BatchStatus_Stuck,
+    BatchStatus_Contradiction,
+    BatchStatus_SolverError
+} BatchStatus;
+
+typedef struct s_batch_task {
+    char *path;
+    Pack *pack; // NULL for plain level files
+    int packIndex;
+    bool packFailed; // the pack at path wouldn't open, all there is to report
+
+    // filled in by the worker
+    BatchStatus status;
+    char *name;
+    int boardSize;
+    bool matches;
+    UniqueResult unique;
+    double ms;
+    long steps;
+    long probes;
+} BatchTask;
+
+typedef struct s_batch {
+    BatchTask *tasks;
+    int numTasks;
+    Pack *packs;
+    int numPacks;
+} Batch;
+
+static const char *_statusString(BatchStatus status)
+{
+    switch (status) {
+    case BatchStatus_LoadError:
+        return "load-error";
+    case BatchStatus_Solved:
+        return "solved";
+    case BatchStatus_Stuck:
+        return "stuck";
+    case BatchStatus_Contradiction:
+        return "contradiction";
+    case BatchStatus_SolverError:
+        return "solver-error";
+    }
+    return "unknown";
+}
+
+static void _solveTask(void *arg, int index, int worker)
+{
+    (void)worker;
+    Batch *batch = (Batch *)arg;
+    BatchTask *task = &batch->tasks[index];
+    Board board;
+    BoardMetadata meta;
+    BoardHints hints;
+
+    task->status = BatchStatus_LoadError;
+    task->unique = UniqueResult_Unknown;
+    if (task->packFailed)
+        return;
+    if (task->pack) {
+        if (!packLoadLevel(task->pack, task->packIndex, &board, &meta, &hints))
+            return;
+    } else {
+        BoardLoadError err;
+        if (!boardLoad(&board, &meta, task->path, &err))
+            return;
+        if (!hintsCreate(&hints, &board)) {
+            boardDestroy(&board);
+            boardMetaDestroy(&meta);
+            return;
+        }
+    }
+
+    task->name = meta.name ? strdup(meta.name) : NULL;
+    task->boardSize = board.size;
+
+    Solver solver;
+    if (solverCreate(&solver, board.size)) {
+        uint64_t start = monotonicNs();
+        solverLoadBoard(&solver, &board);
+        SolveResult result = solverSolve(&solver, &hints);
+        task->unique = result == SolveResult_Solved ? UniqueResult_Unique : UniqueResult_NoSolution;
+        if (result == SolveResult_Stuck) {
+            // picks up where line solving stopped
+            task->unique = solverCheckUnique(&solver, &hints, BATCH_MAX_PROBES, NULL, NULL);
+        }
+        task->ms = (monotonicNs() - start) / 1e6;
+        task->steps = solver.steps;
+        task->probes = solver.probes;
+        task->matches = task->unique == UniqueResult_Unique && solverMatchesSolution(&solver, &board);
+        if (result == SolveResult_Solved)
+            task->status = BatchStatus_Solved;
+        else if (result == SolveResult_Stuck)
+            task->status = BatchStatus_Stuck;
+        else if (result == SolveResult_Contradiction)
+            task->status = BatchStatus_Contradiction;
+        else
+            task->status = BatchStatus_SolverError;
+        solverDestroy(&solver);
+    } else {
+        task->status = BatchStatus_SolverError;
+    }
+
+    hintsDestroy(&hints);
+    boardDestroy(&board);
+    boardMetaDestroy(&meta);
+}
+
+static bool _addTask(Batch *batch, int *cap, char *path, Pack *pack, int packIndex)
+{
+    if (batch->numTasks == *cap) {
+        int newCap = *cap ? *cap * 2 : 64;
+        BatchTask *newTasks = (BatchTask *)realloc(batch->tasks, newCap * sizeof(BatchTask));
+        if (!newTasks)
+            return false;
+        batch->tasks = newTasks;
+        *cap = newCap;
+    }
+    BatchTask *task = &batch->tasks[batch->numTasks++];
+    memset(task, 0, sizeof(BatchTask));
+    task->path = path;
+    task->pack = pack;
+    task->packIndex = packIndex;
+    return true;
+}
+
+static bool _addPackTasks(Batch *batch, int *cap, Pack *pack, const char *path)
+{
+    for (int i = 0; i < packGetNumLevels(pack); i++) {
+        char *taskPath = strdup(path);
+        if (!taskPath || !_addTask(batch, cap, taskPath, pack, i)) {
+            free(taskPath);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lists the levels in source. Packs get opened once and shared by all their
+// tasks since reading them doesn't change anything. The catalog lists a pack
+// that won't open as a single level, which becomes a task reporting a load
+// error, so a broken pack fails --verify instead of going unchecked.
+static bool _collectTasks(Batch *batch, const char *source)
+{
+    int cap = 0;
+    struct stat st;
+    if (stat(source, &st) != 0) {
+        fprintf(stderr, "%s: no such file or directory\n", source);
+        return false;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        batch->packs = (Pack *)malloc(sizeof(Pack));
+        if (!batch->packs || !packOpen(batch->packs, source)) {
+            fprintf(stderr, "%s: not a level pack\n", source);
+            return false;
+        }
+        batch->numPacks = 1;
+        return _addPackTasks(batch, &cap, batch->packs, source);
+    }
+
+    Catalog catalog;
+    if (!catalogLoad(&catalog, source, NULL))
+        return false;
+
+    int numPacks = 0;
+    for (int i = 0; i < catalogGetNumEntries(&catalog); i++)
+        numPacks += catalog.entries[i].packIndex == 0;
+    batch->packs = (Pack *)calloc(numPacks > 0 ? numPacks : 1, sizeof(Pack));
+
+    bool ok = batch->packs != NULL;
+    for (int i = 0; i < catalogGetNumEntries(&catalog) && ok; i++) {
+        CatalogEntry *entry = &catalog.entries[i];
+        char *path = catalogGetPath(&catalog, i);
+        if (!path) {
+            ok = false;
+        } else if (entry->packIndex < 0) {
+            ok = _addTask(batch, &cap, path, NULL, -1);
+            if (!ok)
+                free(path);
+        } else if (entry->packIndex == 0) {
+            // entries of one pack are sorted together, starting at index 0
+            Pack *pack = &batch->packs[batch->numPacks];
+            if (packOpen(pack, path)) {
+                batch->numPacks++;
+                ok = _addPackTasks(batch, &cap, pack, path);
+                free(path);
+            } else {
+                // one load error for the whole pack, so the run still fails
+                ok = _addTask(batch, &cap, path, NULL, -1);
+                if (ok)
+                    batch->tasks[batch->numTasks - 1].packFailed = true;
+                else
+                    free(path);
+            }
+        } else {
+            free(path);
+        }
+    }
+
+    catalogDestroy(&catalog);
+    return ok;
+}
+
+static const char *_uniqueString(UniqueResult unique)
+{
+    switch (unique) {
+    case UniqueResult_Unique:
+        return "true";
+    case UniqueResult_Multiple:
+    case UniqueResult_NoSolution:
+        return "false";
+    default:
+        return "null";
+    }
+}
+
+static void _writeJsonString(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (; str && *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+static bool _writeResults(Batch *batch, const char *output)
+{
+    FILE *fp = strcmp(output, "-") == 0 ? stdout : fopen(output, "w");
+    if (!fp) {
+        fprintf(stderr, "%s: can't open output file\n", output);
+        return false;
+    }
+
+    for (int i = 0; i < batch->numTasks; i++) {
+        BatchTask *task = &batch->tasks[i];
+        bool solvable = task->unique == UniqueResult_Unique || task->unique == UniqueResult_Multiple;
+        bool unknown = task->unique != UniqueResult_Unique && task->unique != UniqueResult_Multiple && task->unique != UniqueResult_NoSolution;
+        fprintf(fp, "{\"path\":");
+        _writeJsonString(fp, task->path);
+        fprintf(fp, ",\"packIndex\":%d,\"name\":", task->packIndex);
+        _writeJsonString(fp, task->name);
+        fprintf(fp, ",\"size\":%d,\"status\":\"%s\"", task->boardSize, _statusString(task->status));
+        // both are null when the search ran out of budget
+        fprintf(fp, ",\"solvable\":%s,\"unique\":%s", unknown ? "null" : solvable ? "true" : "false", _uniqueString(task->unique));
+        fprintf(fp, ",\"matchesSolution\":%s,\"ms\":%.3f,\"steps\":%ld,\"probes\":%ld}\n", task->matches ? "true" : "false", task->ms, task->steps, task->probes);
+    }
+
+    bool ok = !ferror(fp);
+    if (fp != stdout)
+        ok = fclose(fp) == 0 && ok;
+    return ok;
+}
+
+static void _destroyBatch(Batch *batch)
+{
+    for (int i = 0; i < batch->numTasks; i++) {
+        free(batch->tasks[i].path);
+        free(batch->tasks[i].name);
+    }
+    for (int i = 0; i < batch->numPacks; i++)
+        packClose(&batch->packs[i]);
+    free(batch->tasks);
+    free(batch->packs);
+}
+
+int batchRun(BatchMode mode, const char *source, const char *output, int numThreads)
+{
+    Batch batch;
+    memset(&batch, 0, sizeof(Batch));
+    if (numThreads <= 0)
+        numThreads = poolDefaultThreads();
+
+    if (!_collectTasks(&batch, source)) {
+        _destroyBatch(&batch);
+        return 1;
+    }
+
+    uint64_t start = monotonicNs();
+    bool ok = poolRun(numThreads, batch.numTasks, _solveTask, &batch);
+    double ms = (monotonicNs() - start) / 1e6;
+    ok = ok && _writeResults(&batch, output);
+
+    int counts[BatchStatus_SolverError + 1] = {0};
+    int good = 0;
+    int ambiguous = 0;
+    for (int i = 0; i < batch.numTasks; i++) {
+        counts[batch.tasks[i].status]++;
+        good += batch.tasks[i].matches;
+        ambiguous += batch.tasks[i].unique == UniqueResult_Multiple;
+    }
+    printf("%d levels in %.1f ms on %d threads: %d solved, %d stuck, %d contradictions, %d load errors, %d solver errors, %d with several solutions\n",
+        batch.numTasks, ms, numThreads, counts[BatchStatus_Solved], counts[BatchStatus_Stuck],
+        counts[BatchStatus_Contradiction], counts[BatchStatus_LoadError], counts[BatchStatus_SolverError], ambiguous);
+
+    if (mode == BatchMode_Verify && good != batch.numTasks) {
+        printf("%d levels failed verification\n", batch.numTasks - good);
+        ok = false;
+    }
+
+    _destroyBatch(&batch);
+    return ok ? 0 : 1;
+}
@@ -1,192 +1,564 @@
 #include "board.h"
-#include "mtnlog.h"
+#include "bitset.h"
+#include "util.h"
+#include "logger.h"
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 
-void boardCreate(Board *board, int size)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Zeroed memory from the arena, or from the heap without one
+static void *_alloc(Arena *arena, size_t count, size_t size)
+{
+    return arena ? arenaAlloc(arena, count * size) : calloc(count, size);
+}
+
+// Takes the memory from board->arena if it's set
+bool boardCreate(Board *board, int size)
 {
     board->size = size;
-    board->cells = (CellState *)malloc(sizeof(CellState) * size * size);
-    if (!board->cells) {
-        mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to allocate memory for board cells");
-        return;
+    board->wordsPerLine = BITSET_WORDS(size);
+
+    // filled, crosses and their transposed copies share one block
+    size_t planeWords = (size_t)size * board->wordsPerLine;
+    board->filled = (uint64_t *)_alloc(board->arena, 4 * planeWords, sizeof(uint64_t));
+    if (!board->filled) {
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to allocate memory for board cells");
+        return false;
     }
-    
-    for (int i = 0; i < size * size; i++) {
-        board->cells[i] = CellState_Empty;
+    board->crosses = board->filled + planeWords;
+    board->filledCols = board->crosses + planeWords;
+    board->crossCols = board->filledCols + planeWords;
+
+    board->rowMismatches = (int *)_alloc(board->arena, 2 * size, sizeof(int));
+    if (!board->rowMismatches) {
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to allocate mismatch counters");
+        return false;
     }
-    mtnlogMessageTag(MTNLOG_INFO, "board", "Created board with size of %d", size);
+    board->colMismatches = board->rowMismatches + size;
+    board->mismatches = 0;
+    board->wrongRows = 0;
+    board->wrongCols = 0;
+    LOG_MESSAGE(MTNLOG_INFO, "board", "Created board with size of %d", size);
+    return true;
 }
 
-void boardLoad(Board *board, BoardMetadata *boardMeta, const char *name)
+// Returns a bit for every byte of x equal to ch, in byte order
+static unsigned _matchBytes(uint64_t x, char ch)
 {
-    mtnlogMessageTag(MTNLOG_INFO, "board", "Loading board from '%s'", name);
-    boardLoadMeta(boardMeta, &board->size, name);
-    boardLoadSolution(board, name);
-    boardCreate(board, board->size);
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+    uint64_t t = x ^ (0x0101010101010101ull * (unsigned char)ch);
+    uint64_t zero = ~(((t & low7) + low7) | t | low7); // 0x80 in every zero byte
+    return (unsigned)(((zero >> 7) * 0x0102040810204080ull) >> 56);
 }
 
-void boardLoadMeta(BoardMetadata *meta, int *size, const char *name) {
-    mtnlogMessageTag(MTNLOG_INFO, "board", "Loading board metadata from '%s'", name);
+static void _setSolutionCell(Board *board, int x, int y)
+{
+    bitsetSet(board->solved + y * board->wordsPerLine, x);
+    bitsetSet(board->solvedCols + x * board->wordsPerLine, y);
+}
 
-    char *line = NULL;
-    FILE *fp;
-    size_t len = 0;
-    ssize_t read;
+// Parses one solution row. Returns the column of the first invalid character,
+// or -1 if the row is fine.
+static int _parseSolutionRow(Board *board, const char *row, int y)
+{
+    int x = 0;
 
-    fp = fopen(name, "r");
-    if (!fp) {
-        mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to open board file '%s': %s", name, strerror(errno));
-        return;
-    }
-
-    while ((read = getline(&line, &len, fp)) != -1) {
-        if (strncmp(line, "nm ", 3) == 0) {
-            // name
-            line[read - 1] = '\0'; // remove newline
-            mtnlogMessageTag(MTNLOG_INFO, "board", "Found name: '%s'", line + 3);
-            meta->name = strdup(line + 3);
-            if (!meta->name) {
-                mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to allocate buffer for board name");
-                return;
-            }
-            continue;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // 8 cells at a time
+    for (; x + 8 <= board->size; x += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, row + x, sizeof(chunk));
+        unsigned filled = _matchBytes(chunk, '#');
+        unsigned empty = _matchBytes(chunk, '_');
+        if ((filled | empty) != 0xff)
+            return x + __builtin_ctz(~(filled | empty));
+        while (filled) {
+            _setSolutionCell(board, x + __builtin_ctz(filled), y);
+            filled &= filled - 1;
         }
+    }
+#endif
+    for (; x < board->size; x++) {
+        if (row[x] == '#')
+            _setSolutionCell(board, x, y);
+        else if (row[x] != '_')
+            return x;
+    }
+    return -1;
+}
+
+static bool _allocSolution(Board *board)
+{
+    board->wordsPerLine = BITSET_WORDS(board->size);
+    size_t planeWords = (size_t)board->size * board->wordsPerLine;
+    board->solved = (uint64_t *)_alloc(board->arena, 2 * planeWords, sizeof(uint64_t));
+    if (!board->solved)
+        return false;
+    board->solvedCols = board->solved + planeWords;
+    return true;
+}
+
+static char *_copyValue(Arena *arena, const char *start, const char *end)
+{
+    if (arena)
+        return arenaStrndup(arena, start, end - start);
+    char *str = (char *)malloc(end - start + 1);
+    if (str) {
+        memcpy(str, start, end - start);
+        str[end - start] = '\0';
+    }
+    return str;
+}
 
-        if (strncmp(line, "au ", 3) == 0) {
-            // author
-            line[read - 1] = '\0'; // remove newline
-            mtnlogMessageTag(MTNLOG_INFO, "board", "Found author: '%s'", line + 3);
-            meta->author = strdup(line + 3);
-            if (!meta->author) {
-                mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to allocate buffer for board author");
-                return;
+static bool _fail(BoardLoadError *err, BoardLoadResult result, int line, int column)
+{
+    err->result = result;
+    err->line = line;
+    err->column = column;
+    return false;
+}
+
+// Parses a level straight from buf in a single pass. If board is NULL only the
+// metadata is read and parsing stops at the solution section.
+static bool _parse(Board *board, BoardMetadata *meta, int *size, const char *buf, size_t len, BoardLoadError *err)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    int lineNum = 0;
+    int y = 0;
+    bool inSolution = false;
+
+    *size = 0;
+    while (p < end) {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        const char *lineEnd = nl ? nl : end;
+        const char *next = nl ? nl + 1 : end;
+        if (lineEnd > p && lineEnd[-1] == '\r')
+            lineEnd--;
+        size_t lineLen = lineEnd - p;
+        lineNum++;
+
+        if (inSolution) {
+            if (lineLen == 0) {
+                // blank lines are only allowed after the last row
+                p = next;
+                continue;
             }
-            continue;
+            if (y >= *size)
+                return _fail(err, BoardLoadResult_TooManyRows, lineNum, 0);
+            if ((int)lineLen != *size)
+                return _fail(err, BoardLoadResult_BadRowWidth, lineNum, (int)lineLen);
+            int bad = _parseSolutionRow(board, p, y);
+            if (bad >= 0)
+                return _fail(err, BoardLoadResult_BadCell, lineNum, bad + 1);
+            y++;
+        } else if (lineLen == 1 && p[0] == 's') {
+            if (*size <= 0)
+                return _fail(err, BoardLoadResult_MissingSize, lineNum, 0);
+            if (!board)
+                return true;
+            board->size = *size;
+            if (!_allocSolution(board))
+                return _fail(err, BoardLoadResult_AllocationError, lineNum, 0);
+            inSolution = true;
+        } else if (lineLen >= 3 && strncmp(p, "nm ", 3) == 0) {
+            if (!meta->arena)
+                free(meta->name);
+            meta->name = _copyValue(meta->arena, p + 3, lineEnd);
+            if (!meta->name)
+                return _fail(err, BoardLoadResult_AllocationError, lineNum, 0);
+        } else if (lineLen >= 3 && strncmp(p, "au ", 3) == 0) {
+            if (!meta->arena)
+                free(meta->author);
+            meta->author = _copyValue(meta->arena, p + 3, lineEnd);
+            if (!meta->author)
+                return _fail(err, BoardLoadResult_AllocationError, lineNum, 0);
+        } else if (lineLen >= 3 && strncmp(p, "sz ", 3) == 0) {
+            int sz = 0;
+            const char *c = p + 3;
+            for (; c < lineEnd && *c >= '0' && *c <= '9' && sz <= BOARD_MAX_SIZE; c++)
+                sz = sz * 10 + (*c - '0');
+            while (c < lineEnd && (*c == ' ' || *c == '\t'))
+                c++;
+            if (c != lineEnd || sz <= 0 || sz > BOARD_MAX_SIZE)
+                return _fail(err, BoardLoadResult_InvalidSize, lineNum, 4);
+            *size = sz;
+        } else if (lineLen > 0) {
+            err->unknownLines++;
         }
 
-        if (strncmp(line, "sz ", 3) == 0) {
-            // board size
-            line[read - 1] = '\0'; // remove newline
-            mtnlogMessageTag(MTNLOG_INFO, "board", "Found size: '%s'", line + 3);
-            *size = atoi(line + 3);
-            continue;
-        }
+        p = next;
+    }
 
-        if (strcmp(line, "s\n") == 0) {
-            mtnlogMessageTag(MTNLOG_INFO, "board", "Solution section found, stopping finding meta");
-            break;
-        }
+    if (!inSolution)
+        return _fail(err, *size > 0 ? BoardLoadResult_MissingSolution : BoardLoadResult_MissingSize, lineNum, 0);
+    if (y < *size)
+        return _fail(err, BoardLoadResult_TooFewRows, lineNum, 0);
+    return true;
+}
+
+bool boardLoadBuffer(Board *board, BoardMetadata *meta, const char *buf, size_t len, BoardLoadError *err)
+{
+    return boardLoadBufferArena(board, meta, buf, len, err, NULL);
+}
+
+// On failure nothing needs freeing, though the arena keeps what was allocated
+// until it's reset
+bool boardLoadBufferArena(Board *board, BoardMetadata *meta, const char *buf, size_t len, BoardLoadError *err, Arena *arena)
+{
+    memset(board, 0, sizeof(Board));
+    board->arena = arena;
+    meta->name = NULL;
+    meta->author = NULL;
+    meta->arena = arena;
+    memset(err, 0, sizeof(BoardLoadError));
+
+    int size;
+    if (!_parse(board, meta, &size, buf, len, err) || !boardCreate(board, size)) {
+        if (err->result == BoardLoadResult_OK)
+            err->result = BoardLoadResult_AllocationError;
+        boardDestroy(board);
+        boardMetaDestroy(meta);
+        return false;
+    }
+
+    boardResetMismatches(board);
+    return true;
+}
+
+bool boardLoadMetaBuffer(BoardMetadata *meta, int *size, const char *buf, size_t len, BoardLoadError *err)
+{
+    meta->name = NULL;
+    meta->author = NULL;
+    meta->arena = NULL;
+    memset(err, 0, sizeof(BoardLoadError));
+
+    if (!_parse(NULL, meta, size, buf, len, err)) {
+        boardMetaDestroy(meta);
+        return false;
+    }
+    return true;
+}
+
+static void _logLoadError(const char *name, BoardLoadError *err)
+{
+    if (err->result == BoardLoadResult_OpenError)
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to open board file '%s': %s", name, strerror(errno));
+    else
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to load '%s' (line %d, column %d): %s", name, err->line, err->column, boardLoadResultString(err->result));
+}
 
-        mtnlogMessageTag(MTNLOG_WARNING, "board", "Invalid metadata in '%s': %s", name, line);
+bool boardLoad(Board *board, BoardMetadata *boardMeta, const char *name, BoardLoadError *err)
+{
+    return boardLoadArena(board, boardMeta, name, err, NULL);
+}
+
+bool boardLoadArena(Board *board, BoardMetadata *boardMeta, const char *name, BoardLoadError *err, Arena *arena)
+{
+    LOG_MESSAGE(MTNLOG_INFO, "board", "Loading board from '%s'", name);
+
+    size_t len;
+    const char *buf = mapFile(name, &len);
+    if (!buf) {
+        memset(err, 0, sizeof(BoardLoadError));
+        err->result = BoardLoadResult_OpenError;
+        _logLoadError(name, err);
+        return false;
     }
 
-    free(line);
-    fclose(fp);
+    bool ok = boardLoadBufferArena(board, boardMeta, buf, len, err, arena);
+    unmapFile(buf, len);
+    if (!ok)
+        _logLoadError(name, err);
+    return ok;
 }
 
-void boardLoadSolution(Board *board, const char *name)
+bool boardLoadMeta(BoardMetadata *meta, int *size, const char *name, BoardLoadError *err)
 {
-    mtnlogMessageTag(MTNLOG_INFO, "board", "Loading solution from file '%s'", name);
-    board->solved = (CellState *)malloc(sizeof(CellState) * board->size * board->size);
-    if (!board->solved) {
-        mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to allocate solution buffer");
-        return;
+    size_t len;
+    const char *buf = mapFile(name, &len);
+    if (!buf) {
+        memset(err, 0, sizeof(BoardLoadError));
+        err->result = BoardLoadResult_OpenError;
+        return false;
     }
 
-    FILE *fp = fopen(name, "r");
+    bool ok = boardLoadMetaBuffer(meta, size, buf, len, err);
+    unmapFile(buf, len);
+    return ok;
+}
+
+// Writes the solution in the same format boardLoad reads
+bool boardSave(Board *board, BoardMetadata *meta, const char *name)
+{
+    FILE *fp = fopen(name, "w");
     if (!fp) {
-        mtnlogMessageTag(MTNLOG_ERROR, "board", "Failed to open file '%s': %s", name, strerror(errno));
-        return;
-    }
-    char *line = NULL;
-    size_t len = 0;
-    ssize_t read;
-    bool doRead = false;
-    int i = 0;
-    while ((read = getline(&line, &len, fp)) != -1) {
-        if (strcmp(line, "s\n") == 0) {
-            mtnlogMessageTag(MTNLOG_INFO, "board", "Found solution section. Starting getting solution.");
-            doRead = true;
-            continue;
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to create board file '%s': %s", name, strerror(errno));
+        return false;
+    }
+
+    if (meta->name)
+        fprintf(fp, "nm %s\n", meta->name);
+    if (meta->author)
+        fprintf(fp, "au %s\n", meta->author);
+    fprintf(fp, "sz %d\ns\n", board->size);
+
+    char *row = (char *)malloc(board->size + 1);
+    bool ok = row != NULL;
+    for (int y = 0; y < board->size && ok; y++) {
+        const uint64_t *bits = board->solved + y * board->wordsPerLine;
+        for (int x = 0; x < board->size; x++)
+            row[x] = bitsetGet(bits, x) ? '#' : '_';
+        row[board->size] = '\n';
+        ok = fwrite(row, 1, board->size + 1, fp) == (size_t)board->size + 1;
+    }
+    free(row);
+
+    ok = fclose(fp) == 0 && ok;
+    if (!ok)
+        LOG_MESSAGE(MTNLOG_ERROR, "board", "Failed to write board file '%s'", name);
+    return ok;
+}
+
+// Packed solutions are one bit per cell, row after row, with bit i of the
+// stream being bit i % 8 of byte i / 8
+bool boardLoadPacked(Board *board, const unsigned char *bits, int size)
+{
+    return boardLoadPackedArena(board, bits, size, NULL);
+}
+
+bool boardLoadPackedArena(Board *board, const unsigned char *bits, int size, Arena *arena)
+{
+    memset(board, 0, sizeof(Board));
+    board->arena = arena;
+    board->size = size;
+    if (size <= 0 || size > BOARD_MAX_SIZE || !_allocSolution(board))
+        return false;
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            size_t i = (size_t)y * size + x;
+            if ((bits[i >> 3] >> (i & 7)) & 1)
+                _setSolutionCell(board, x, y);
         }
+    }
 
-        if (doRead) {
-            for (int j = 0; j < board->size; j++) {
-                char ch = line[j];
-                CellState st;
-                switch (ch) {
-                case '#':
-                    st = CellState_Filled;
-                    break;
-                case '_':
-                    st = CellState_Empty;
-                    break;
-                default:
-                    mtnlogMessageTag(MTNLOG_WARNING, "board", "Found unknown cell char '%c' in file '%s', assuming empty", ch, name);
-                    st = CellState_Empty;
-                    break;
-                }
-
-                board->solved[j + i * board->size] = st;
-            }
-            i++;
+    if (!boardCreate(board, size)) {
+        boardDestroy(board);
+        return false;
+    }
+    boardResetMismatches(board);
+    return true;
+}
+
+size_t boardPackedSize(int size)
+{
+    return ((size_t)size * size + 7) / 8;
+}
+
+void boardPackSolution(Board *board, unsigned char *bits)
+{
+    memset(bits, 0, boardPackedSize(board->size));
+    for (int y = 0; y < board->size; y++) {
+        for (int x = 0; x < board->size; x++) {
+            size_t i = (size_t)y * board->size + x;
+            if (bitsetGet(board->solved + y * board->wordsPerLine, x))
+                bits[i >> 3] |= 1 << (i & 7);
         }
     }
-    fclose(fp);
+}
+
+const char *boardLoadResultString(BoardLoadResult result)
+{
+    switch (result) {
+    case BoardLoadResult_OK:
+        return "OK";
+    case BoardLoadResult_OpenError:
+        return "can't open file";
+    case BoardLoadResult_AllocationError:
+        return "out of memory";
+    case BoardLoadResult_MissingSize:
+        return "missing size";
+    case BoardLoadResult_InvalidSize:
+        return "invalid size";
+    case BoardLoadResult_MissingSolution:
+        return "missing solution section";
+    case BoardLoadResult_BadRowWidth:
+        return "solution row width doesn't match size";
+    case BoardLoadResult_BadCell:
+        return "unknown cell character";
+    case BoardLoadResult_TooManyRows:
+        return "too many solution rows";
+    case BoardLoadResult_TooFewRows:
+        return "too few solution rows";
+    }
+    return "unknown error";
 }
 
 CellState boardGetCell(Board *board, int x, int y)
 {
-    return board->cells[x + y * board->size];
+    const uint64_t *row = board->filled + y * board->wordsPerLine;
+    if (bitsetGet(row, x))
+        return CellState_Filled;
+    if (bitsetGet(board->crosses + y * board->wordsPerLine, x))
+        return CellState_Cross;
+    return CellState_Empty;
+}
+
+static void _addMismatch(Board *board, int x, int y, int delta)
+{
+    int oldRow = board->rowMismatches[y];
+    int oldCol = board->colMismatches[x];
+    board->rowMismatches[y] += delta;
+    board->colMismatches[x] += delta;
+    board->mismatches += delta;
+    board->wrongRows += (board->rowMismatches[y] != 0) - (oldRow != 0);
+    board->wrongCols += (board->colMismatches[x] != 0) - (oldCol != 0);
 }
 
 void boardSetCell(Board *board, int x, int y, CellState state)
 {
-    board->cells[x + y * board->size] = state;
+    uint64_t *filledRow = board->filled + y * board->wordsPerLine;
+    uint64_t *crossRow = board->crosses + y * board->wordsPerLine;
+    uint64_t *filledCol = board->filledCols + x * board->wordsPerLine;
+    uint64_t *crossCol = board->crossCols + x * board->wordsPerLine;
+    bool shouldFill = bitsetGet(board->solved + y * board->wordsPerLine, x);
+    bool wasWrong = bitsetGet(filledRow, x) != shouldFill;
+    bool isWrong = (state == CellState_Filled) != shouldFill;
+
+    if (wasWrong != isWrong)
+        _addMismatch(board, x, y, isWrong ? 1 : -1);
+
+    bitsetClear(filledRow, x);
+    bitsetClear(crossRow, x);
+    bitsetClear(filledCol, y);
+    bitsetClear(crossCol, y);
+    if (state == CellState_Filled) {
+        bitsetSet(filledRow, x);
+        bitsetSet(filledCol, y);
+    } else if (state == CellState_Cross) {
+        bitsetSet(crossRow, x);
+        bitsetSet(crossCol, y);
+    }
 }
 
 void boardDestroy(Board *board)
 {
-    free(board->cells);
-    free(board->solved);
+    // the other planes live in the same blocks
+    if (!board->arena) {
+        free(board->filled);
+        free(board->solved);
+        free(board->rowMismatches);
+    }
+    board->filled = NULL;
+    board->solved = NULL;
+    board->rowMismatches = NULL;
 }
 
 void boardMetaDestroy(BoardMetadata *board)
 {
-    free(board->name);
-    free(board->author);
+    if (!board->arena) {
+        free(board->name);
+        free(board->author);
+    }
+    board->name = NULL;
+    board->author = NULL;
 }
 
-static bool _compareStatesForSolve(CellState s1, CellState s2)
+bool boardIsSolved(Board *board)
 {
-    if (s1 == s2)
-        return true;
-    if (s1 == CellState_Empty && s2 == CellState_Cross)
-        return true;
-    if (s1 == CellState_Cross && s2 == CellState_Empty)
-        return true;
-    return false;
+    return board->mismatches == 0;
 }
 
-bool boardIsSolved(Board *board)
+// Crosses count as empty when checking a solution, so a board is solved
+// exactly when its filled plane equals the solution plane.
+bool boardMatchesSolution(Board *board)
+{
+    const uint64_t *a = board->filled;
+    const uint64_t *b = board->solved;
+    size_t n = (size_t)board->size * board->wordsPerLine;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        if (!_mm256_testz_si256(x, x))
+            return false;
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xffff)
+            return false;
+    }
+#endif
+    for (; i < n; i++) {
+        if (a[i] != b[i])
+            return false;
+    }
+
+    return true;
+}
+
+int boardCountMismatches(Board *board)
+{
+    size_t n = (size_t)board->size * board->wordsPerLine;
+    int count = 0;
+    for (size_t i = 0; i < n; i++)
+        count += __builtin_popcountll(board->filled[i] ^ board->solved[i]);
+    return count;
+}
+
+void boardResetMismatches(Board *board)
 {
-    bool diff = false;
+    int wpl = board->wordsPerLine;
+    board->mismatches = 0;
+    board->wrongRows = 0;
+    board->wrongCols = 0;
     for (int i = 0; i < board->size; i++) {
-        for (int j = 0; j < board->size; j++) {
-            CellState a = board->cells[i + j * board->size];
-            CellState b = board->solved[i + j * board->size];
-            if (!_compareStatesForSolve(a, b)) {
-                diff = true;
-                break;
-            }
+        int row = 0;
+        int col = 0;
+        for (int w = 0; w < wpl; w++) {
+            row += __builtin_popcountll(board->filled[i * wpl + w] ^ board->solved[i * wpl + w]);
+            col += __builtin_popcountll(board->filledCols[i * wpl + w] ^ board->solvedCols[i * wpl + w]);
         }
-        if (diff)
-            break;
+        board->rowMismatches[i] = row;
+        board->colMismatches[i] = col;
+        board->mismatches += row;
+        board->wrongRows += row != 0;
+        board->wrongCols += col != 0;
     }
+}
+
+int boardCellsLeft(Board *board)
+{
+    return board->mismatches;
+}
+
+int boardRowMismatches(Board *board, int y)
+{
+    return board->rowMismatches[y];
+}
 
-    return !diff;
+int boardColMismatches(Board *board, int x)
+{
+    return board->colMismatches[x];
+}
+
+int boardWrongRows(Board *board)
+{
+    return board->wrongRows;
+}
+
+int boardWrongCols(Board *board)
+{
+    return board->wrongCols;
 }
@@ -0,0 +1,449 @@
+#include "boardrender.h"
+#include "profiler.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// SDL_RenderGeometry showed up in SDL 2.0.18, older versions draw crosses line
+// by line
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define BOARDRENDER_GEOMETRY 1
+#else
+#define BOARDRENDER_GEOMETRY 0
+#endif
+
+// SDL_SetTextureScaleMode showed up in SDL 2.0.12, older versions take the
+// scale quality hint when the texture gets created
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+#define BOARDRENDER_SCALE_MODE 1
+#else
+#define BOARDRENDER_SCALE_MODE 0
+#endif
+
+#define CROSS_VERTS 8
+#define CROSS_INDICES 12
+
+static const SDL_Color _cellColor = {128, 128, 128, 255};
+static const SDL_Color _lineColor = {160, 160, 160, 255};
+static const SDL_Color _hoverColor = {230, 230, 230, 255};
+static const SDL_Color _outlineColor = {0, 0, 128, 255};
+static const SDL_Color _hoverOutlineColor = {0, 0, 255, 255};
+static const SDL_Color _markColor = {80, 80, 80, 255};
+static const SDL_Color _hoverMarkColor = {120, 120, 120, 255};
+static const SDL_Color _lodCrossColor = {104, 104, 104, 255};
+
+void boardRendererInit(BoardRenderer *renderer)
+{
+    memset(renderer, 0, sizeof(BoardRenderer));
+    renderer->dirty = true;
+    renderer->lodDirtyMin = 0;
+    renderer->lodDirtyMax = BOARD_MAX_SIZE - 1;
+}
+
+void boardRendererDestroy(BoardRenderer *renderer)
+{
+    free(renderer->gridRects);
+    free(renderer->filledRects);
+    free(renderer->crossCells);
+    free(renderer->crossVerts);
+    free(renderer->crossIndices);
+    if (renderer->lodTexture)
+        SDL_DestroyTexture(renderer->lodTexture);
+    boardRendererInit(renderer);
+}
+
+void boardRendererInvalidate(BoardRenderer *renderer)
+{
+    renderer->dirty = true;
+    renderer->lodDirtyMin = 0;
+    renderer->lodDirtyMax = BOARD_MAX_SIZE - 1;
+}
+
+// Only row y of the far zoom texture gets uploaded again
+void boardRendererInvalidateCell(BoardRenderer *renderer, int x, int y)
+{
+    (void)x;
+    renderer->dirty = true;
+    if (y < renderer->lodDirtyMin)
+        renderer->lodDirtyMin = y;
+    if (y > renderer->lodDirtyMax)
+        renderer->lodDirtyMax = y;
+}
+
+// For when the renderer lost its textures, the far zoom texture gets created
+// again on the next draw
+void boardRendererResetTextures(BoardRenderer *renderer)
+{
+    if (renderer->lodTexture)
+        SDL_DestroyTexture(renderer->lodTexture);
+    renderer->lodTexture = NULL;
+    boardRendererInvalidate(renderer);
+}
+
+static bool _grow(void **buf, int *cap, int needed, size_t elemSize)
+{
+    if (needed <= *cap)
+        return true;
+    int newCap = *cap ? *cap : 64;
+    while (newCap < needed)
+        newCap *= 2;
+    void *newBuf = realloc(*buf, newCap * elemSize);
+    if (!newBuf)
+        return false;
+    *buf = newBuf;
+    *cap = newCap;
+    PROFILE_ALLOC(newCap * elemSize);
+    return true;
+}
+
+static void _setColor(SDL_Renderer *rend, SDL_Color color)
+{
+    SDL_SetRenderDrawColor(rend, color.r, color.g, color.b, color.a);
+}
+
+// The cross is two strokes an eighth of a cell wide, at 32 pixel cells that
+// matches the 4 diagonal lines per stroke it used to be drawn with
+static void _crossVertices(SDL_Vertex *verts, int x, int y, int cellSize, SDL_Color color)
+{
+    float unit = cellSize / 32.0f;
+    float left = x + 5.0f * unit;
+    float right = x + cellSize - 5.0f * unit;
+    float top = y + 6.0f * unit;
+    float bottom = y + cellSize - 7.0f * unit;
+    float stroke = 4.0f * unit;
+    const SDL_FPoint points[CROSS_VERTS] = {
+        {left, top}, {left + stroke, top}, {right, bottom}, {right - stroke, bottom},
+        {left, bottom}, {left + stroke, bottom}, {right, top}, {right - stroke, top}
+    };
+    for (int i = 0; i < CROSS_VERTS; i++) {
+        verts[i].position = points[i];
+        verts[i].color = color;
+        verts[i].tex_coord.x = 0.0f;
+        verts[i].tex_coord.y = 0.0f;
+    }
+}
+
+static void _crossIndices(int *indices, int first)
+{
+    static const int quads[CROSS_INDICES] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7};
+    for (int i = 0; i < CROSS_INDICES; i++)
+        indices[i] = first + quads[i];
+}
+
+// Draws crosses first to first + count - 1, the indices of a cross point at
+// its own vertices so only the index range has to be cut
+static void _drawCrosses(SDL_Renderer *rend, const SDL_Vertex *verts, const int *indices, const SDL_Point *cells, int first, int count, int cellSize)
+{
+    if (count <= 0)
+        return;
+#if BOARDRENDER_GEOMETRY
+    (void)cells;
+    (void)cellSize;
+    SDL_RenderGeometry(rend, NULL, verts, (first + count) * CROSS_VERTS, indices + first * CROSS_INDICES, count * CROSS_INDICES);
+#else
+    (void)verts;
+    (void)indices;
+    int in = cellSize * 6 / 32;
+    int out = cellSize * 8 / 32;
+    int stroke = cellSize / 8 > 1 ? cellSize / 8 : 1;
+    for (int i = first; i < first + count; i++) {
+        for (int k = 0; k < stroke; k++) {
+            int cx = cells[i].x + k - stroke / 4;
+            int cy = cells[i].y;
+            SDL_RenderDrawLine(rend, cx + in, cy + in, cx + cellSize - out, cy + cellSize - out);
+            SDL_RenderDrawLine(rend, cx + in, cy + cellSize - out, cx + cellSize - out, cy + in);
+        }
+    }
+#endif
+}
+
+// Every cell outline is 1 pixel inside the cell, so the grid is two lines per
+// cell edge spanning the visible cells
+static bool _buildGrid(BoardRenderer *renderer)
+{
+    SDL_Rect cells = renderer->cells;
+    int cs = renderer->cellSize;
+    int left = renderer->boardX + cells.x * cs;
+    int top = renderer->boardY + cells.y * cs;
+    if (!_grow((void **)&renderer->gridRects, &renderer->gridCap, 2 * (cells.w + cells.h), sizeof(SDL_Rect)))
+        return false;
+
+    SDL_Rect *rects = renderer->gridRects;
+    int n = 0;
+    for (int i = 0; i < cells.w; i++) {
+        int x = left + i * cs;
+        rects[n++] = (SDL_Rect){x, top, 1, cells.h * cs};
+        rects[n++] = (SDL_Rect){x + cs - 1, top, 1, cells.h * cs};
+    }
+    for (int i = 0; i < cells.h; i++) {
+        int y = top + i * cs;
+        rects[n++] = (SDL_Rect){left, y, cells.w * cs, 1};
+        rects[n++] = (SDL_Rect){left, y + cs - 1, cells.w * cs, 1};
+    }
+    renderer->numGridRects = n;
+    return true;
+}
+
+static bool _addCross(BoardRenderer *renderer, int x, int y)
+{
+    int i = renderer->numCrosses;
+    int cap = renderer->crossCap;
+    if (i == cap) {
+        int cellsCap = cap;
+        int vertsCap = cap * CROSS_VERTS;
+        int indicesCap = cap * CROSS_INDICES;
+        if (!_grow((void **)&renderer->crossCells, &cellsCap, i + 1, sizeof(SDL_Point))
+            || !_grow((void **)&renderer->crossVerts, &vertsCap, cellsCap * CROSS_VERTS, sizeof(SDL_Vertex))
+            || !_grow((void **)&renderer->crossIndices, &indicesCap, cellsCap * CROSS_INDICES, sizeof(int)))
+            return false;
+        renderer->crossCap = cellsCap;
+    }
+
+    renderer->crossCells[i] = (SDL_Point){x, y};
+    _crossVertices(renderer->crossVerts + i * CROSS_VERTS, x, y, renderer->cellSize, _markColor);
+    _crossIndices(renderer->crossIndices + i * CROSS_INDICES, i * CROSS_VERTS);
+    renderer->numCrosses++;
+    return true;
+}
+
+// Only the cells on screen go into the batches
+static bool _build(BoardRenderer *renderer, Board *board)
+{
+    int cs = renderer->cellSize;
+    int inset = cs / 8;
+    SDL_Rect cells = renderer->cells;
+    renderer->numFilled = 0;
+    renderer->numCrosses = 0;
+    if (!_buildGrid(renderer))
+        return false;
+
+    for (int y = cells.y; y < cells.y + cells.h; y++) {
+        for (int x = cells.x; x < cells.x + cells.w; x++) {
+            int cellX = renderer->boardX + x * cs;
+            int cellY = renderer->boardY + y * cs;
+            switch (boardGetCell(board, x, y)) {
+            case CellState_Filled:
+                if (!_grow((void **)&renderer->filledRects, &renderer->filledCap, renderer->numFilled + 1, sizeof(SDL_Rect)))
+                    return false;
+                renderer->filledRects[renderer->numFilled++] = (SDL_Rect){cellX + inset, cellY + inset, cs - 2 * inset, cs - 2 * inset};
+                break;
+            case CellState_Cross:
+                if (!_addCross(renderer, cellX, cellY))
+                    return false;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static int _floorDiv(int a, int b)
+{
+    return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+// The cells of the batches that reach into the clip rect, all of them when
+// clipping is off. A dirty region only needs those drawn.
+static SDL_Rect _clipCells(BoardRenderer *renderer, SDL_Renderer *rend)
+{
+    SDL_Rect cells = renderer->cells;
+    if (!SDL_RenderIsClipEnabled(rend))
+        return cells;
+    SDL_Rect clip;
+    SDL_RenderGetClipRect(rend, &clip);
+    int cs = renderer->cellSize;
+    int left = _floorDiv(clip.x - renderer->boardX, cs);
+    int top = _floorDiv(clip.y - renderer->boardY, cs);
+    int right = _floorDiv(clip.x + clip.w - 1 - renderer->boardX, cs) + 1;
+    int bottom = _floorDiv(clip.y + clip.h - 1 - renderer->boardY, cs) + 1;
+    if (left < cells.x)
+        left = cells.x;
+    if (top < cells.y)
+        top = cells.y;
+    if (right > cells.x + cells.w)
+        right = cells.x + cells.w;
+    if (bottom > cells.y + cells.h)
+        bottom = cells.y + cells.h;
+    if (right <= left || bottom <= top)
+        return (SDL_Rect){cells.x, cells.y, 0, 0};
+    return (SDL_Rect){left, top, right - left, bottom - top};
+}
+
+// The batches are built row by row, so the marks at or below pixel row y are
+// everything from the returned index on
+static int _firstRectFrom(const SDL_Rect *rects, int count, int y)
+{
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rects[mid].y < y)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int _firstPointFrom(const SDL_Point *points, int count, int y)
+{
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (points[mid].y < y)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static Uint32 _lodPixel(CellState state)
+{
+    SDL_Color color = {0, 0, 0, 0}; // empty cells show the board underneath
+    if (state == CellState_Filled)
+        color = _markColor;
+    else if (state == CellState_Cross)
+        color = _lodCrossColor;
+    return ((Uint32)color.r << 24) | ((Uint32)color.g << 16) | ((Uint32)color.b << 8) | color.a;
+}
+
+// One texel per cell, only the rows touched since the last upload get copied
+static bool _updateLod(BoardRenderer *renderer, SDL_Renderer *rend, Board *board)
+{
+    int n = board->size;
+    if (!renderer->lodTexture || renderer->lodSize != n) {
+        if (renderer->lodTexture)
+            SDL_DestroyTexture(renderer->lodTexture);
+#if !BOARDRENDER_SCALE_MODE
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+#endif
+        renderer->lodTexture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, n, n);
+        renderer->lodSize = n;
+        if (!renderer->lodTexture) {
+            LOG_MESSAGE(MTNLOG_WARNING, "render", "Failed to create %dx%d board texture: %s", n, n, SDL_GetError());
+            return false;
+        }
+        PROFILE_ALLOC((size_t)n * n * 4);
+#if BOARDRENDER_SCALE_MODE
+        SDL_SetTextureScaleMode(renderer->lodTexture, SDL_ScaleModeNearest);
+#endif
+        SDL_SetTextureBlendMode(renderer->lodTexture, SDL_BLENDMODE_BLEND);
+        renderer->lodDirtyMin = 0;
+        renderer->lodDirtyMax = n - 1;
+    }
+
+    int first = renderer->lodDirtyMin;
+    int last = renderer->lodDirtyMax < n ? renderer->lodDirtyMax : n - 1;
+    if (first > last)
+        return true;
+
+    SDL_Rect rows = {0, first, n, last - first + 1};
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(renderer->lodTexture, &rows, &pixels, &pitch) != 0)
+        return false;
+    for (int y = first; y <= last; y++) {
+        Uint32 *row = (Uint32 *)((Uint8 *)pixels + (size_t)(y - first) * pitch);
+        for (int x = 0; x < n; x++)
+            row[x] = _lodPixel(boardGetCell(board, x, y));
+    }
+    SDL_UnlockTexture(renderer->lodTexture);
+    renderer->lodDirtyMin = BOARD_MAX_SIZE;
+    renderer->lodDirtyMax = -1;
+    return true;
+}
+
+void boardRendererDraw(BoardRenderer *renderer, SDL_Renderer *rend, Board *board, const Camera *camera, int hoverX, int hoverY)
+{
+    int boardX = camera->boardX;
+    int boardY = camera->boardY;
+    int cellSize = camera->cellSize;
+    SDL_Rect cells = cameraVisibleCells(camera);
+    bool lod = cellSize < BOARDRENDER_LOD_CELL_SIZE && _updateLod(renderer, rend, board);
+
+    if (board->size != renderer->size || boardX != renderer->boardX || boardY != renderer->boardY || cellSize != renderer->cellSize
+        || !SDL_RectEquals(&cells, &renderer->cells))
+        renderer->dirty = true;
+    if (renderer->dirty && !lod) {
+        renderer->size = board->size;
+        renderer->boardX = boardX;
+        renderer->boardY = boardY;
+        renderer->cellSize = cellSize;
+        renderer->cells = cells;
+        if (!_build(renderer, board)) {
+            LOG_MESSAGE(MTNLOG_ERROR, "render", "Failed to allocate board render batches");
+            return;
+        }
+        renderer->dirty = false;
+    }
+
+    SDL_Rect visible = {boardX + cells.x * cellSize, boardY + cells.y * cellSize, cells.w * cellSize, cells.h * cellSize};
+    _setColor(rend, _cellColor);
+    SDL_RenderFillRect(rend, &visible);
+
+    // the hovered row and column light up under the hovered cell
+    bool hovering = hoverX >= 0 && hoverY >= 0 && hoverX < board->size && hoverY < board->size;
+    SDL_Rect cellRect = {boardX + hoverX * cellSize, boardY + hoverY * cellSize, cellSize, cellSize};
+    if (hovering) {
+        SDL_Rect col = {cellRect.x, visible.y, cellSize, visible.h};
+        SDL_Rect row = {visible.x, cellRect.y, visible.w, cellSize};
+        _setColor(rend, _lineColor);
+        SDL_RenderFillRect(rend, &col);
+        SDL_RenderFillRect(rend, &row);
+        _setColor(rend, _hoverColor);
+        SDL_RenderFillRect(rend, &cellRect);
+    }
+
+    // far out the whole board is one texture and there's no room for a grid
+    if (lod) {
+        SDL_RenderCopy(rend, renderer->lodTexture, &cells, &visible);
+        return;
+    }
+
+    SDL_Rect clipped = _clipCells(renderer, rend);
+    if (clipped.w > 0) {
+        // the first 2 * cells.w grid rects are column edges, the rest row edges
+        _setColor(rend, _outlineColor);
+        SDL_RenderFillRects(rend, renderer->gridRects + 2 * (clipped.x - cells.x), 2 * clipped.w);
+        SDL_RenderFillRects(rend, renderer->gridRects + 2 * cells.w + 2 * (clipped.y - cells.y), 2 * clipped.h);
+    }
+    if (hovering) {
+        _setColor(rend, _hoverOutlineColor);
+        SDL_RenderDrawRect(rend, &cellRect);
+    }
+
+    if (clipped.w > 0) {
+        int top = boardY + clipped.y * cellSize;
+        int bottom = top + clipped.h * cellSize;
+        int firstFilled = _firstRectFrom(renderer->filledRects, renderer->numFilled, top);
+        int endFilled = _firstRectFrom(renderer->filledRects, renderer->numFilled, bottom);
+        int firstCross = _firstPointFrom(renderer->crossCells, renderer->numCrosses, top);
+        int endCross = _firstPointFrom(renderer->crossCells, renderer->numCrosses, bottom);
+        _setColor(rend, _markColor);
+        if (endFilled > firstFilled)
+            SDL_RenderFillRects(rend, renderer->filledRects + firstFilled, endFilled - firstFilled);
+        _drawCrosses(rend, renderer->crossVerts, renderer->crossIndices, renderer->crossCells, firstCross, endCross - firstCross, cellSize);
+    }
+
+    // redraw the hovered cell's mark in the lighter color
+    if (hovering) {
+        _setColor(rend, _hoverMarkColor);
+        CellState state = boardGetCell(board, hoverX, hoverY);
+        if (state == CellState_Filled) {
+            int inset = cellSize / 8;
+            SDL_Rect mark = {cellRect.x + inset, cellRect.y + inset, cellSize - 2 * inset, cellSize - 2 * inset};
+            SDL_RenderFillRect(rend, &mark);
+        } else if (state == CellState_Cross) {
+            SDL_Vertex verts[CROSS_VERTS];
+            int indices[CROSS_INDICES];
+            SDL_Point cell = {cellRect.x, cellRect.y};
+            _crossVertices(verts, cell.x, cell.y, cellSize, _hoverMarkColor);
+            _crossIndices(indices, 0);
+            _drawCrosses(rend, verts, indices, &cell, 0, 1, cellSize);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "camera.h"
+
+static const int _zoomLevels[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64};
+#define NUM_ZOOM_LEVELS ((int)(sizeof(_zoomLevels) / sizeof(_zoomLevels[0])))
+
+// A board that fits gets centered, a larger one can be dragged around as long
+// as some of it stays on screen
+static int _clampAxis(int pos, int extent, int view)
+{
+    if (extent <= view)
+        return (view - extent) / 2;
+    int min = view - extent - CAMERA_PAN_MARGIN;
+    int max = CAMERA_PAN_MARGIN;
+    return pos < min ? min : pos > max ? max : pos;
+}
+
+static void _clamp(Camera *camera)
+{
+    int cs = camera->cellSize;
+    int clueX = camera->clueW * cs;
+    int clueY = camera->clueH * cs;
+    camera->boardX = _clampAxis(camera->boardX - clueX, (camera->boardSize + camera->clueW) * cs, camera->viewW) + clueX;
+    camera->boardY = _clampAxis(camera->boardY - clueY, (camera->boardSize + camera->clueH) * cs, camera->viewH) + clueY;
+}
+
+// Picks the largest zoom level up to CAMERA_FIT_CELL_SIZE that shows the whole
+// board with its clues, or the smallest one if none does
+void cameraFit(Camera *camera, int boardSize, int clueW, int clueH, int viewW, int viewH)
+{
+    camera->boardSize = boardSize;
+    camera->clueW = clueW;
+    camera->clueH = clueH;
+    camera->viewW = viewW;
+    camera->viewH = viewH;
+    camera->zoom = 0;
+    for (int i = 0; i < NUM_ZOOM_LEVELS && _zoomLevels[i] <= CAMERA_FIT_CELL_SIZE; i++) {
+        if ((boardSize + clueW) * _zoomLevels[i] <= viewW && (boardSize + clueH) * _zoomLevels[i] <= viewH)
+            camera->zoom = i;
+    }
+    camera->cellSize = _zoomLevels[camera->zoom];
+    camera->boardX = (viewW - (boardSize + clueW) * camera->cellSize) / 2 + clueW * camera->cellSize;
+    camera->boardY = (viewH - (boardSize + clueH) * camera->cellSize) / 2 + clueH * camera->cellSize;
+    _clamp(camera);
+}
+
+// Keeps whatever was in the middle of the view in the middle
+void cameraSetView(Camera *camera, int viewW, int viewH)
+{
+    camera->boardX += (viewW - camera->viewW) / 2;
+    camera->boardY += (viewH - camera->viewH) / 2;
+    camera->viewW = viewW;
+    camera->viewH = viewH;
+    _clamp(camera);
+}
+
+// Zooms by steps levels while keeping the board point under the anchor in
+// place, returns whether anything changed
+bool cameraZoom(Camera *camera, int steps, int anchorX, int anchorY)
+{
+    int zoom = camera->zoom + steps;
+    if (zoom < 0)
+        zoom = 0;
+    if (zoom >= NUM_ZOOM_LEVELS)
+        zoom = NUM_ZOOM_LEVELS - 1;
+    if (zoom == camera->zoom)
+        return false;
+
+    int oldSize = camera->cellSize;
+    int newSize = _zoomLevels[zoom];
+    camera->boardX = anchorX - (int)((long long)(anchorX - camera->boardX) * newSize / oldSize);
+    camera->boardY = anchorY - (int)((long long)(anchorY - camera->boardY) * newSize / oldSize);
+    camera->zoom = zoom;
+    camera->cellSize = newSize;
+    _clamp(camera);
+    return true;
+}
+
+bool cameraPan(Camera *camera, int dx, int dy)
+{
+    int oldX = camera->boardX;
+    int oldY = camera->boardY;
+    camera->boardX += dx;
+    camera->boardY += dy;
+    _clamp(camera);
+    return camera->boardX != oldX || camera->boardY != oldY;
+}
+
+// Stores the cell under a screen position, even when that's outside the
+// board, and returns whether it's on the board
+bool cameraCellAt(const Camera *camera, int screenX, int screenY, int *x, int *y)
+{
+    int localX = screenX - camera->boardX;
+    int localY = screenY - camera->boardY;
+    // round towards negative infinity so the row left of the board is -1
+    *x = localX >= 0 ? localX / camera->cellSize : -((-localX + camera->cellSize - 1) / camera->cellSize);
+    *y = localY >= 0 ? localY / camera->cellSize : -((-localY + camera->cellSize - 1) / camera->cellSize);
+    return *x >= 0 && *y >= 0 && *x < camera->boardSize && *y < camera->boardSize;
+}
+
+// Cells that are at least partly on screen, in cell coordinates
+SDL_Rect cameraVisibleCells(const Camera *camera)
+{
+    int cs = camera->cellSize;
+    int x0 = camera->boardX < 0 ? -camera->boardX / cs : 0;
+    int y0 = camera->boardY < 0 ? -camera->boardY / cs : 0;
+    int x1 = (camera->viewW - camera->boardX + cs - 1) / cs;
+    int y1 = (camera->viewH - camera->boardY + cs - 1) / cs;
+    if (x1 > camera->boardSize)
+        x1 = camera->boardSize;
+    if (y1 > camera->boardSize)
+        y1 = camera->boardSize;
+    SDL_Rect cells = {x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0};
+    return cells;
+}
@@ -0,0 +1,416 @@
+#include "catalog.h"
+#include "util.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static bool _addEntry(Catalog *catalog, CatalogEntry *entry)
+{
+    if (catalog->numEntries == catalog->cap) {
+        int newCap = catalog->cap ? catalog->cap * 2 : 64;
+        CatalogEntry *newEntries = (CatalogEntry *)realloc(catalog->entries, newCap * sizeof(CatalogEntry));
+        if (!newEntries)
+            return false;
+        catalog->entries = newEntries;
+        catalog->cap = newCap;
+    }
+    catalog->entries[catalog->numEntries++] = *entry;
+    return true;
+}
+
+static void _freeEntry(CatalogEntry *entry)
+{
+    free(entry->file);
+    free(entry->name);
+    free(entry->author);
+}
+
+static int _compareEntries(const void *a, const void *b)
+{
+    const CatalogEntry *ea = (const CatalogEntry *)a;
+    const CatalogEntry *eb = (const CatalogEntry *)b;
+    int c = strcmp(ea->file, eb->file);
+    return c != 0 ? c : ea->packIndex - eb->packIndex;
+}
+
+static char *_joinPath(const char *dir, const char *file)
+{
+    size_t len = strlen(dir) + strlen(file) + 2;
+    char *path = (char *)malloc(len);
+    if (path)
+        snprintf(path, len, "%s/%s", dir, file);
+    return path;
+}
+
+static bool _isPackFile(const char *file)
+{
+    size_t len = strlen(file);
+    size_t extLen = strlen(PACK_EXTENSION);
+    return len > extLen && strcmp(file + len - extLen, PACK_EXTENSION) == 0;
+}
+
+static char *_readString(const char **p, const char *end, uint16_t len)
+{
+    if (len > end - *p)
+        return NULL;
+    char *str = (char *)malloc(len + 1);
+    if (str) {
+        memcpy(str, *p, len);
+        str[len] = '\0';
+        *p += len;
+    }
+    return str;
+}
+
+// Reads the cache into old, sorted the same way as the catalog
+static void _readCache(Catalog *old, const char *cacheFile)
+{
+    size_t len;
+    const char *buf = mapFile(cacheFile, &len);
+    if (!buf)
+        return;
+
+    const char *p = buf;
+    const char *end = buf + len;
+    uint32_t version;
+    uint32_t count;
+    if (len < 12 || memcmp(p, CATALOG_MAGIC, 4) != 0) {
+        unmapFile(buf, len);
+        return;
+    }
+    memcpy(&version, p + 4, 4);
+    memcpy(&count, p + 8, 4);
+    p += 12;
+
+    for (uint32_t i = 0; i < count && version == CATALOG_VERSION; i++) {
+        CatalogEntry entry;
+        int32_t packIndex;
+        int32_t boardSize;
+        uint16_t lens[3];
+        if (end - p < 30)
+            break;
+        memcpy(&entry.mtime, p, 8);
+        memcpy(&entry.fileSize, p + 8, 8);
+        memcpy(&packIndex, p + 16, 4);
+        memcpy(&boardSize, p + 20, 4);
+        memcpy(lens, p + 24, 6);
+        p += 30;
+
+        entry.packIndex = packIndex;
+        entry.boardSize = boardSize;
+        entry.metaLoaded = true;
+        entry.file = _readString(&p, end, lens[0]);
+        entry.name = _readString(&p, end, lens[1]);
+        entry.author = _readString(&p, end, lens[2]);
+        if (!entry.file || !entry.name || !entry.author || !_addEntry(old, &entry)) {
+            _freeEntry(&entry);
+            break;
+        }
+    }
+
+    unmapFile(buf, len);
+    qsort(old->entries, old->numEntries, sizeof(CatalogEntry), _compareEntries);
+}
+
+// Index of the first cached entry for file, or -1
+static int _findCached(Catalog *old, const char *file)
+{
+    int lo = 0;
+    int hi = old->numEntries;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(old->entries[mid].file, file) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < old->numEntries && strcmp(old->entries[lo].file, file) == 0 ? lo : -1;
+}
+
+// A pack that won't open still gets listed, as one level under its file name
+// that fails to load, like a broken level file
+static bool _addBrokenPack(Catalog *catalog, const char *file, struct stat *st)
+{
+    LOG_MESSAGE(MTNLOG_WARNING, "catalog", "Pack '%s' is broken, listing it as one level", file);
+    CatalogEntry entry;
+    entry.file = strdup(file);
+    entry.name = strdup(file);
+    entry.author = strdup("");
+    entry.mtime = st->st_mtime;
+    entry.fileSize = st->st_size;
+    entry.packIndex = 0;
+    entry.boardSize = 0;
+    entry.metaLoaded = true;
+    bool ok = entry.file && entry.name && entry.author && _addEntry(catalog, &entry);
+    if (!ok)
+        _freeEntry(&entry);
+    return ok;
+}
+
+static bool _addPack(Catalog *catalog, const char *file, const char *path, struct stat *st)
+{
+    Pack pack;
+    if (!packOpen(&pack, path))
+        return _addBrokenPack(catalog, file, st);
+
+    bool ok = true;
+    for (int i = 0; i < packGetNumLevels(&pack) && ok; i++) {
+        CatalogEntry entry;
+        entry.file = strdup(file);
+        entry.name = strdup(packGetName(&pack, i));
+        entry.author = strdup(packGetAuthor(&pack, i));
+        entry.mtime = st->st_mtime;
+        entry.fileSize = st->st_size;
+        entry.packIndex = i;
+        entry.boardSize = packGetBoardSize(&pack, i);
+        entry.metaLoaded = true;
+        ok = entry.file && entry.name && entry.author && _addEntry(catalog, &entry);
+        if (!ok)
+            _freeEntry(&entry);
+    }
+
+    packClose(&pack);
+    return ok;
+}
+
+static bool _addFile(Catalog *catalog, Catalog *old, const char *file)
+{
+    char *path = _joinPath(catalog->dir, file);
+    if (!path)
+        return false;
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        free(path);
+        return true;
+    }
+
+    // reuse cached entries if the file didn't change
+    int cached = _findCached(old, file);
+    if (cached >= 0 && old->entries[cached].mtime == (int64_t)st.st_mtime && old->entries[cached].fileSize == (int64_t)st.st_size) {
+        free(path);
+        for (int i = cached; i < old->numEntries && strcmp(old->entries[i].file, file) == 0; i++) {
+            if (!_addEntry(catalog, &old->entries[i]))
+                return false;
+            // the new catalog owns the strings now
+            old->entries[i].metaLoaded = false;
+        }
+        return true;
+    }
+
+    catalog->dirty = true;
+    if (_isPackFile(file)) {
+        bool ok = _addPack(catalog, file, path, &st);
+        free(path);
+        return ok;
+    }
+    free(path);
+
+    // metadata gets parsed when it's first needed
+    CatalogEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.file = strdup(file);
+    entry.mtime = st.st_mtime;
+    entry.fileSize = st.st_size;
+    entry.packIndex = -1;
+    if (!entry.file || !_addEntry(catalog, &entry)) {
+        free(entry.file);
+        return false;
+    }
+    return true;
+}
+
+bool catalogLoad(Catalog *catalog, const char *dir, const char *cacheFile)
+{
+    memset(catalog, 0, sizeof(Catalog));
+    catalog->dir = strdup(dir);
+    catalog->cacheFile = cacheFile ? strdup(cacheFile) : NULL;
+    if (!catalog->dir || (cacheFile && !catalog->cacheFile)) {
+        LOG_MESSAGE(MTNLOG_ERROR, "catalog", "Failed to allocate catalog");
+        catalogDestroy(catalog);
+        return false;
+    }
+
+    Catalog old;
+    memset(&old, 0, sizeof(Catalog));
+    if (cacheFile)
+        _readCache(&old, cacheFile);
+
+    DIR *d = opendir(dir);
+    if (!d) {
+        LOG_MESSAGE(MTNLOG_ERROR, "catalog", "Failed to open levels dir: %s", strerror(errno));
+        catalogDestroy(&old);
+        catalogDestroy(catalog);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *de;
+    while (ok && (de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.')
+            continue;
+        ok = _addFile(catalog, &old, de->d_name);
+    }
+    closedir(d);
+
+    // anything left in the old catalog was removed from the directory
+    for (int i = 0; i < old.numEntries; i++) {
+        if (old.entries[i].metaLoaded) {
+            catalog->dirty = true;
+            _freeEntry(&old.entries[i]);
+        }
+    }
+    free(old.entries);
+
+    if (!ok) {
+        LOG_MESSAGE(MTNLOG_ERROR, "catalog", "Failed to build level catalog");
+        catalogDestroy(catalog);
+        return false;
+    }
+
+    qsort(catalog->entries, catalog->numEntries, sizeof(CatalogEntry), _compareEntries);
+    LOG_MESSAGE(MTNLOG_INFO, "catalog", "Found %d levels in '%s'", catalog->numEntries, dir);
+    return true;
+}
+
+// Entries with a string too long for the cache get parsed again next time
+static bool _isCached(CatalogEntry *entry)
+{
+    return entry->metaLoaded && strlen(entry->file) <= UINT16_MAX && strlen(entry->name) <= UINT16_MAX && strlen(entry->author) <= UINT16_MAX;
+}
+
+static bool _writeEntry(FILE *fp, CatalogEntry *entry)
+{
+    int32_t packIndex = entry->packIndex;
+    int32_t boardSize = entry->boardSize;
+    size_t fileLen = strlen(entry->file);
+    size_t nameLen = strlen(entry->name);
+    size_t authorLen = strlen(entry->author);
+    uint16_t lens[3] = { (uint16_t)fileLen, (uint16_t)nameLen, (uint16_t)authorLen };
+
+    return fwrite(&entry->mtime, 8, 1, fp) == 1 && fwrite(&entry->fileSize, 8, 1, fp) == 1
+        && fwrite(&packIndex, 4, 1, fp) == 1 && fwrite(&boardSize, 4, 1, fp) == 1 && fwrite(lens, 2, 3, fp) == 3
+        && fwrite(entry->file, 1, fileLen, fp) == fileLen && fwrite(entry->name, 1, nameLen, fp) == nameLen
+        && fwrite(entry->author, 1, authorLen, fp) == authorLen;
+}
+
+bool catalogSave(Catalog *catalog)
+{
+    if (!catalog->dirty || !catalog->cacheFile)
+        return true;
+
+    uint32_t version = CATALOG_VERSION;
+    uint32_t count = 0;
+    for (int i = 0; i < catalog->numEntries; i++)
+        count += _isCached(&catalog->entries[i]);
+
+    FILE *fp = fopen(catalog->cacheFile, "wb");
+    if (!fp) {
+        LOG_MESSAGE(MTNLOG_ERROR, "catalog", "Failed to write catalog cache '%s': %s", catalog->cacheFile, strerror(errno));
+        return false;
+    }
+
+    bool ok = fwrite(CATALOG_MAGIC, 1, 4, fp) == 4 && fwrite(&version, 4, 1, fp) == 1 && fwrite(&count, 4, 1, fp) == 1;
+    for (int i = 0; i < catalog->numEntries && ok; i++) {
+        if (_isCached(&catalog->entries[i]))
+            ok = _writeEntry(fp, &catalog->entries[i]);
+    }
+    ok = fclose(fp) == 0 && ok;
+
+    if (ok)
+        catalog->dirty = false;
+    else
+        LOG_MESSAGE(MTNLOG_ERROR, "catalog", "Failed to write catalog cache '%s'", catalog->cacheFile);
+    return ok;
+}
+
+void catalogDestroy(Catalog *catalog)
+{
+    for (int i = 0; i < catalog->numEntries; i++)
+        _freeEntry(&catalog->entries[i]);
+    free(catalog->entries);
+    free(catalog->dir);
+    free(catalog->cacheFile);
+    free(catalog->packFile);
+    if (catalog->pack.data)
+        packClose(&catalog->pack);
+    memset(catalog, 0, sizeof(Catalog));
+}
+
+int catalogGetNumEntries(Catalog *catalog)
+{
+    return catalog->numEntries;
+}
+
+CatalogEntry *catalogGetEntry(Catalog *catalog, int index)
+{
+    CatalogEntry *entry = &catalog->entries[index];
+    if (entry->metaLoaded)
+        return entry;
+
+    BoardMetadata meta;
+    BoardLoadError err;
+    int size = 0;
+    char *path = _joinPath(catalog->dir, entry->file);
+    if (path && boardLoadMeta(&meta, &size, path, &err)) {
+        entry->name = meta.name ? meta.name : strdup(entry->file);
+        entry->author = meta.author ? meta.author : strdup("");
+        entry->boardSize = size;
+    } else {
+        // still list broken levels, under their file name
+        entry->name = strdup(entry->file);
+        entry->author = strdup("");
+        entry->boardSize = 0;
+    }
+    free(path);
+
+    if (!entry->name || !entry->author) {
+        free(entry->name);
+        free(entry->author);
+        entry->name = NULL;
+        entry->author = NULL;
+        return entry;
+    }
+    entry->metaLoaded = true;
+    catalog->dirty = true;
+    return entry;
+}
+
+char *catalogGetPath(Catalog *catalog, int index)
+{
+    return _joinPath(catalog->dir, catalog->entries[index].file);
+}
+
+// Whatever level held before is unloaded first
+bool catalogLoadLevel(Catalog *catalog, int index, Level *level)
+{
+    CatalogEntry *entry = &catalog->entries[index];
+    char *path = _joinPath(catalog->dir, entry->file);
+    if (!path)
+        return false;
+
+    if (entry->packIndex < 0) {
+        BoardLoadError err;
+        bool ok = levelLoadFile(level, path, &err);
+        free(path);
+        return ok;
+    }
+
+    if (!catalog->packFile || strcmp(catalog->packFile, entry->file) != 0) {
+        if (catalog->pack.data)
+            packClose(&catalog->pack);
+        free(catalog->packFile);
+        catalog->packFile = NULL;
+        if (!packOpen(&catalog->pack, path)) {
+            free(path);
+            return false;
+        }
+        catalog->packFile = strdup(entry->file);
+    }
+    free(path);
+    return levelLoadPack(level, &catalog->pack, entry->packIndex);
+}
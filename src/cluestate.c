@@ -0,0 +1,120 @@
+#include "cluestate.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// First filled cell at or after from, -1 if there is none
+static int _nextFilled(const uint64_t *line, int wpl, int from)
+{
+    int w = from / 64;
+    if (w >= wpl)
+        return -1;
+    uint64_t bits = line[w] & (~0ull << (from % 64));
+    while (!bits) {
+        if (++w == wpl)
+            return -1;
+        bits = line[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
+
+// Whether cells first to last are filled exactly where the solution is
+static bool _matches(const uint64_t *filled, const uint64_t *solved, int first, int last)
+{
+    for (int w = first / 64; w <= last / 64; w++) {
+        uint64_t mask = ~0ull;
+        if (w == first / 64)
+            mask &= ~0ull << (first % 64);
+        if (w == last / 64)
+            mask &= ~0ull >> (63 - last % 64);
+        if ((filled[w] ^ solved[w]) & mask)
+            return false;
+    }
+    return true;
+}
+
+// The clues come from the solution, so clue i is the solution's i-th run and
+// the next one starts at the first filled cell after it. Returns whether any
+// flag of the line changed.
+static bool _evaluateLine(ClueState *state, int line, const uint64_t *filled, const uint64_t *solved)
+{
+    int n = state->board->size;
+    int wpl = state->board->wordsPerLine;
+    int offset = state->hints->lines[line];
+    int count = state->hints->data[offset];
+    const int *clues = state->hints->data + offset + 1;
+    bool *done = state->done + offset + 1;
+
+    bool changed = false;
+    int pos = 0;
+    for (int i = 0; i < count; i++) {
+        int start = _nextFilled(solved, wpl, pos);
+        bool isDone = false;
+        if (start >= 0) {
+            int end = start + clues[i]; // first cell after the run
+            isDone = _matches(filled, solved, start > 0 ? start - 1 : 0, end < n ? end : n - 1);
+            pos = end;
+        }
+        changed |= done[i] != isDone;
+        done[i] = isDone;
+    }
+    return changed;
+}
+
+void clueStateInit(ClueState *state)
+{
+    memset(state, 0, sizeof(ClueState));
+}
+
+void clueStateDestroy(ClueState *state)
+{
+    free(state->done);
+    clueStateInit(state);
+}
+
+// The only full pass, every line gets evaluated once for the board as it is
+bool clueStateStart(ClueState *state, Board *board, BoardHints *hints)
+{
+    size_t size = hintsDataSize(hints);
+    if (size > state->cap) {
+        bool *done = (bool *)realloc(state->done, size * sizeof(bool));
+        if (!done) {
+            LOG_MESSAGE(MTNLOG_ERROR, "clues", "Failed to allocate %zu clue flags", size);
+            return false;
+        }
+        state->done = done;
+        state->cap = size;
+    }
+    memset(state->done, 0, size * sizeof(bool));
+    state->board = board;
+    state->hints = hints;
+
+    int wpl = board->wordsPerLine;
+    for (int i = 0; i < board->size; i++) {
+        _evaluateLine(state, i, board->filled + i * wpl, board->solved + i * wpl);
+        _evaluateLine(state, board->size + i, board->filledCols + i * wpl, board->solvedCols + i * wpl);
+    }
+    return true;
+}
+
+// Call after every boardSetCell. Returns whether any clue of row y or column x
+// changed.
+bool clueStateUpdate(ClueState *state, int x, int y)
+{
+    Board *board = state->board;
+    int wpl = board->wordsPerLine;
+    bool row = _evaluateLine(state, y, board->filled + y * wpl, board->solved + y * wpl);
+    bool col = _evaluateLine(state, board->size + x, board->filledCols + x * wpl, board->solvedCols + x * wpl);
+    return row || col;
+}
+
+// Flags in the same order as hintsGetRow's clues
+const bool *clueStateGetRow(ClueState *state, int y)
+{
+    return state->done + state->hints->lines[y] + 1;
+}
+
+const bool *clueStateGetCol(ClueState *state, int x)
+{
+    return state->done + state->hints->lines[state->board->size + x] + 1;
+}
@@ -1,19 +1,29 @@
 #include "game.h"
-#include "mtnlog.h"
+#include "logger.h"
 #include "board.h"
-#include "hints.h"
+#include "level.h"
+#include "loader.h"
+#include "catalog.h"
+#include "levellist.h"
+#include "boardrender.h"
+#include "cluestate.h"
+#include "play.h"
+#include "replay.h"
+#include "redraw.h"
+#include "textcache.h"
+#include "gameclock.h"
+#include "profiler.h"
 #include "args.h"
 #include "util.h"
 #include "version.h"
 #include "SDL_FontCache.h"
 #include <SDL2/SDL.h>
 #include <stdbool.h>
-#include <unistd.h>
-#include <pthread.h>
-#include <dirent.h>
-#include <errno.h>
+#include <string.h>
 
-#define CELL_SIZE 32
+#define LEVEL_LIST_TOP 40
+#define LEVEL_LIST_BOTTOM_MARGIN 40 // room for the tooltips
+#define CLUE_MIN_CELL_SIZE 16 // clues next to smaller cells would be unreadable
 
 static SDL_Window *_window = NULL;
 static SDL_Renderer *_rend = NULL;
@@ -26,53 +36,36 @@ static FC_Font *_font;
 static int _screenWidth = 0;
 static int _screenHeight = 0;
 
-static Board _board;
-static BoardMetadata _boardMeta;
-static BoardHints _hints;
-static bool _boardSolved = false;
-static int _boardX = 100;
-static int _boardY = 30;
-static int _time = 0;
-static bool _incTime = true;
-static pthread_t _incTimeThread;
-static bool _incTaskRunning = true;
-static char **_levelList = NULL;
-static int _numLevels = 0;
-static int _selectedLevel = 0;
-
-static void *_timeIncrementTask(void *arg)
-{
-    (void)arg;
-    while (true) {
-        if (_incTime)
-            _time++;
-        sleepMs(1);
-        if (!_incTaskRunning)
-            break;
-    }
-    return NULL;
-}
-
-static void _setBoardPos(void)
-{
-    _boardX = _screenWidth / 2 - (_board.size * CELL_SIZE / 2);
-    _boardY = _screenHeight / 2 - (_board.size * CELL_SIZE / 2);
-}
-
-static void _loadBoard(const char *name)
-{
-    boardLoad(&_board, &_boardMeta, name);
-    hintsCreate(&_hints, _board.size);
-    _setBoardPos();
-}
+static Loader _loader;
+static Level *_level = NULL; // owned by the loader, pinned while it's played
+static int _pendingLevel = -1; // level to start as soon as the loader has it
+static int _prefetchedLevel = -1; // selected level the last prefetch was around
+static Uint32 _levelLoadedEvent;
+static Play _play;
+static ClueState _clues;
+static ReplayWriter _recording;
+static GameClock _solveClock;
+static FrameStats _frameStats;
+static Catalog _catalog;
+static LevelList _levelList;
+static BoardRenderer _boardRenderer;
+static Redraw _redraw;
+static TextCache _textCache;
+static SDL_Texture *_frame = NULL; // persistent frame that dirty regions get redrawn into
+static int _hoverX = -1;
+static int _hoverY = -1;
+static int _shownTime = -1; // timer value on screen, in hundredths of a second
+static bool _showProfiler = false;
+static uint64_t _profilerShownNs = 0;
+static double _loadMs = 0.0;
 
 static bool _sdlInit(void)
 {
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
-        mtnlogMessageTag(MTNLOG_ERROR, "init", "Failed to init SDL: %s", SDL_GetError());
+        LOG_MESSAGE(MTNLOG_ERROR, "init", "Failed to init SDL: %s", SDL_GetError());
         return false;
     }
-    mtnlogMessageTag(MTNLOG_INFO, "init", "SDL initialized");
+    LOG_MESSAGE(MTNLOG_INFO, "init", "SDL initialized");
     return true;
 }
 
@@ -80,10 +73,10 @@ static bool _createWindow(void)
 {
     _window = SDL_CreateWindow("Pikurosu", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, _screenWidth, _screenHeight, SDL_WINDOW_RESIZABLE);
     if (!_window) {
-        mtnlogMessageTag(MTNLOG_ERROR, "init", "Failed to create window: %s", SDL_GetError());
+        LOG_MESSAGE(MTNLOG_ERROR, "init", "Failed to create window: %s", SDL_GetError());
         return false;
     }
-    mtnlogMessageTag(MTNLOG_INFO, "init", "Created window");
+    LOG_MESSAGE(MTNLOG_INFO, "init", "Created window");
     return true;
 }
 
@@ -91,62 +84,246 @@ static bool _createRenderer(void)
 {
     _rend = SDL_CreateRenderer(_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!_rend) {
-        mtnlogMessageTag(MTNLOG_ERROR, "init", "Failed to create renderer: %s", SDL_GetError());
+        LOG_MESSAGE(MTNLOG_ERROR, "init", "Failed to create renderer: %s", SDL_GetError());
         return false;
     }
     return true;
 }
 
-static bool _findLevels(void)
+// Without a frame texture every redraw has to repaint the whole screen, since
+// the back buffer doesn't keep its contents between presents
+static void _createFrame(void)
+{
+    int w, h;
+    if (_frame)
+        SDL_DestroyTexture(_frame);
+    _frame = NULL;
+    if (SDL_GetRendererOutputSize(_rend, &w, &h) == 0)
+        _frame = SDL_CreateTexture(_rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!_frame)
+        LOG_MESSAGE(MTNLOG_WARNING, "init", "Failed to create frame texture, redrawing the whole screen: %s", SDL_GetError());
+    redrawMarkAll(&_redraw);
+}
+
+static SDL_Rect _timeTextRect(void)
+{
+    SDL_Rect rect = {0, 0, _screenWidth, 10 + FC_GetLineHeight(_font)};
+    return rect;
+}
+
+#define PROFILER_OVERLAY_WIDTH 280
+#define PROFILER_OVERLAY_LINES 5
+#define PROFILER_OVERLAY_LINE_HEIGHT 14
+#define PROFILER_REFRESH_MS 500
+
+static SDL_Rect _profilerRect(void)
+{
+    SDL_Rect rect = {_screenWidth - PROFILER_OVERLAY_WIDTH, 0, PROFILER_OVERLAY_WIDTH, 8 + PROFILER_OVERLAY_LINES * PROFILER_OVERLAY_LINE_HEIGHT};
+    return rect;
+}
+
+// row is a position in the filtered list, not a catalog index
+static SDL_Rect _levelRowRect(int row)
+{
+    SDL_Rect rect = {0, LEVEL_LIST_TOP + LEVEL_LIST_ROW_HEIGHT * (row - _levelList.first), _screenWidth, LEVEL_LIST_ROW_HEIGHT + 3};
+    return rect;
+}
+
+static SDL_Rect _levelListRect(void)
+{
+    SDL_Rect rect = {0, LEVEL_LIST_TOP, _screenWidth, LEVEL_LIST_ROW_HEIGHT * _levelList.numRows + 3};
+    return rect;
+}
+
+static void _setLevelListRows(void)
 {
-    if (_levelList) {
-        for (int i = 0; i < _numLevels; i++)
-            free(_levelList[i]);
-        free(_levelList);
+    levelListSetNumRows(&_levelList, (_screenHeight - LEVEL_LIST_TOP - LEVEL_LIST_BOTTOM_MARGIN) / LEVEL_LIST_ROW_HEIGHT);
+}
+
+// Marks only the two rows when the view didn't scroll
+static void _selectLevelRow(int row)
+{
+    int oldSelected = _levelList.selected;
+    int oldFirst = _levelList.first;
+    if (!levelListSelect(&_levelList, row))
+        return;
+    if (_levelList.first != oldFirst) {
+        redrawMark(&_redraw, _levelListRect());
+    } else {
+        redrawMark(&_redraw, _levelRowRect(oldSelected));
+        redrawMark(&_redraw, _levelRowRect(_levelList.selected));
     }
-    _levelList = (char **)malloc(5 * sizeof(char *));
-    if (!_levelList) {
-        mtnlogMessageTag(MTNLOG_ERROR, "findlevels", "Failed to allocate level list");
-        return false;
+}
+
+static SDL_Rect _cellRect(int x, int y)
+{
+    SDL_Rect rect = {_play.camera.boardX + x * _play.camera.cellSize, _play.camera.boardY + y * _play.camera.cellSize, _play.camera.cellSize, _play.camera.cellSize};
+    return rect;
+}
+
+// The clues of row y go left of it and the clues of column x above it, in as
+// many cells as the camera left room for
+static SDL_Rect _rowCluesRect(int y)
+{
+    int cs = _play.camera.cellSize;
+    SDL_Rect rect = {_play.camera.boardX - _play.camera.clueW * cs, _play.camera.boardY + y * cs, _play.camera.clueW * cs, cs};
+    return rect;
+}
+
+static SDL_Rect _colCluesRect(int x)
+{
+    int cs = _play.camera.cellSize;
+    SDL_Rect rect = {_play.camera.boardX + x * cs, _play.camera.boardY - _play.camera.clueH * cs, cs, _play.camera.clueH * cs};
+    return rect;
+}
+
+// Marks the highlighted row and column strips, they change together with the
+// hovered cell
+static void _markHover(int x, int y)
+{
+    if (!_level)
+        return;
+    int extent = _level->board.size * _play.camera.cellSize;
+    if (x >= 0) {
+        SDL_Rect col = {_play.camera.boardX + x * _play.camera.cellSize, _play.camera.boardY, _play.camera.cellSize, extent};
+        redrawMark(&_redraw, col);
+    }
+    if (y >= 0) {
+        SDL_Rect row = {_play.camera.boardX, _play.camera.boardY + y * _play.camera.cellSize, extent, _play.camera.cellSize};
+        redrawMark(&_redraw, row);
     }
+}
 
-    DIR *d = opendir("./levels");
-    if (d) {
-        struct dirent *de;
-        while ((de = readdir(d)) != NULL) {
-            if (strcmp(".", de->d_name) == 0 || strcmp("..", de->d_name) == 0) {
-                continue;
-            }
+static void _updateHover(void)
+{
+    int x = -1;
+    int y = -1;
+    if (_gState == GameState_Game && !cameraCellAt(&_play.camera, _mouseX, _mouseY, &x, &y))
+        x = y = -1;
+    if (x == _hoverX && y == _hoverY)
+        return;
+    _markHover(_hoverX, _hoverY);
+    _markHover(x, y);
+    _hoverX = x;
+    _hoverY = y;
+}
 
-            if (de->d_type == DT_REG) {
-                mtnlogMessageTag(MTNLOG_INFO, "findlevels", "Found regular file '%s'", de->d_name);
-                int nameStrLen = strlen(de->d_name);
-                char *nameStr = (char *)malloc(nameStrLen + 1);
-                if (!nameStr) {
-                    mtnlogMessageTag(MTNLOG_ERROR, "findlevels", "Failed to allocate nameStr for %s", de->d_name);
-                    return false;
-                }
-                sprintf(nameStr, "%s", de->d_name);
-                _numLevels++;
-                _levelList = (char **)realloc(_levelList, _numLevels * sizeof(char *));
-                if (!_levelList) {
-                    mtnlogMessageTag(MTNLOG_ERROR, "findlevels", "Failed to realloc level list");
-                    return false;
-                }
-                _levelList[_numLevels - 1] = nameStr;
-            }
-        }
-        closedir(d);
-        for (int i = 0; i < _numLevels; i++) {
-            mtnlogMessageTag(MTNLOG_INFO, "findlevels", "%s", _levelList[i]);
+static void _onCameraMoved(void)
+{
+    _updateHover();
+    redrawMarkAll(&_redraw);
+}
+
+// Called on the loader thread
+static void _onLevelLoaded(void *arg, int index)
+{
+    (void)arg;
+    SDL_Event ev;
+    memset(&ev, 0, sizeof(SDL_Event));
+    ev.type = _levelLoadedEvent;
+    ev.user.code = index;
+    SDL_PushEvent(&ev);
+}
+
+// Starts the pending level if the loader has it by now
+static void _startPendingLevel(void)
+{
+    bool failed;
+    double loadMs;
+    Level *level = loaderAcquire(&_loader, _pendingLevel, &failed, &loadMs);
+    if (!level) {
+        if (failed) {
+            _pendingLevel = -1;
+            redrawMarkAll(&_redraw);
         }
-        return true;
-    } else {
-        mtnlogMessageTag(MTNLOG_ERROR, "findlevels", "Failed to open levels dir: %s", strerror(errno));
-        return false;
+        return;
+    }
+    if (!clueStateStart(&_clues, &level->board, &level->hints)) {
+        loaderRelease(&_loader, level);
+        _pendingLevel = -1;
+        redrawMarkAll(&_redraw);
+        return;
+    }
+
+    // a recording belongs to the board it was made on
+    if (_level) {
+        if (_recording.fp)
+            replayWriterClose(&_recording, &_level->board);
+        loaderRelease(&_loader, _level);
+    }
+    _level = level;
+    _pendingLevel = -1;
+    _loadMs = loadMs;
+
+    playStart(&_play, &_level->board, &_level->hints, _screenWidth, _screenHeight);
+    boardRendererInvalidate(&_boardRenderer);
+    gameClockStart(&_solveClock);
+    if (argsGetRecordFile())
+        replayWriterOpen(&_recording, argsGetRecordFile(), &_level->board, _screenWidth, _screenHeight);
+    _gState = GameState_Game;
+    _updateHover();
+    redrawMarkAll(&_redraw);
+}
+
+// Plays the level right away if it was prefetched, otherwise once it arrives
+static void _playLevel(int index)
+{
+    _pendingLevel = index;
+    loaderRequest(&_loader, index);
+    _startPendingLevel();
+    if (_pendingLevel >= 0)
+        redrawMarkAll(&_redraw); // shows that it's loading
+}
+
+// Keeps the levels around the selection loaded, in list order
+static void _prefetchAroundSelection(void)
+{
+    int selected = levelListGetSelectedLevel(&_levelList);
+    if (selected == _prefetchedLevel)
+        return;
+    _prefetchedLevel = selected;
+
+    int indices[1 + 2 * LOADER_PREFETCH_RADIUS];
+    int count = 0;
+    indices[count++] = selected;
+    for (int i = 1; i <= LOADER_PREFETCH_RADIUS; i++) {
+        indices[count++] = levelListGetLevel(&_levelList, _levelList.selected + i);
+        indices[count++] = levelListGetLevel(&_levelList, _levelList.selected - i);
+    }
+    loaderPrefetch(&_loader, indices, count);
+}
+
+// Only the cell's row and column can have clues that changed
+static void _onCellChanged(void *arg, int x, int y)
+{
+    (void)arg;
+    boardRendererInvalidateCell(&_boardRenderer, x, y);
+    redrawMark(&_redraw, _cellRect(x, y));
+    if (clueStateUpdate(&_clues, x, y)) {
+        redrawMark(&_redraw, _rowCluesRect(y));
+        redrawMark(&_redraw, _colCluesRect(x));
     }
 }
 
+static void _onBoardSolved(void *arg)
+{
+    (void)arg;
+    LOG_MESSAGE(MTNLOG_INFO, "event", "Board is solved");
+    gameClockPause(&_solveClock);
+    redrawMark(&_redraw, _timeTextRect());
+    int64_t solveMs = gameClockElapsedMs(&_solveClock);
+    LOG_MESSAGE(MTNLOG_INFO, "event", "Solve time: %lld ms (%.2f s)", (long long)solveMs, solveMs / 1000.0);
+}
+
+// Everything that reaches the board goes through here, so a recording holds
+// exactly what the board saw. Returns whether the camera moved.
+static bool _playEvent(const PlayEvent *pe)
+{
+    if (_recording.fp)
+        replayWriterAdd(&_recording, pe);
+    return playHandleEvent(&_play, pe);
+}
+
 static void _toggleFullscreen(bool enable)
 {
     int c;
@@ -155,25 +332,25 @@ static void _toggleFullscreen(bool enable)
     else
         c = SDL_SetWindowFullscreen(_window, 0);
     if (c != 0) {
-        mtnlogMessageTag(MTNLOG_ERROR, "init", "Failed to set fullscreen: %s", SDL_GetError());
+        LOG_MESSAGE(MTNLOG_ERROR, "init", "Failed to set fullscreen: %s", SDL_GetError());
     }
     _isFullscreen = enable;
 }
 
-static bool _init(int argc, char **argv)
+static bool _init(void)
 {
-    if (argsParse(argc, argv) != ArgParseResult_OK)
-        return false;
-
     _screenWidth = argsGetScreenWidth();
     _screenHeight = argsGetScreenHeight();
 
     mtnlogInit(MTNLOG_INFO, "pikurosu.log");
     mtnlogColor(true);
     mtnlogMessage(MTNLOG_INFO, "Pikurosu %d.%d.%d, build on " __DATE__ " " __TIME__, PIKUROSU_MAJOR, PIKUROSU_MINOR, PIKUROSU_PATCH);
+    loggerStart(MTNLOG_INFO);
 
     if (!_sdlInit() || !_createWindow() || !_createRenderer())
         return false;
+    redrawInit(&_redraw);
+    _createFrame();
 
     // fullscreen
     _toggleFullscreen(argsGetFullscreen());
@@ -182,22 +359,28 @@ static bool _init(int argc, char **argv)
     _font = FC_CreateFont();
     FC_LoadFont(_font, _rend, "fonts/static/NotoSans-Regular.ttf", 24, FC_MakeColor(255, 255, 255, 255), TTF_STYLE_NORMAL); 
     FC_SetFilterMode(_font, FC_FILTER_LINEAR); // filtering
-    mtnlogMessageTag(MTNLOG_INFO, "init", "Loaded font");
+    LOG_MESSAGE(MTNLOG_INFO, "init", "Loaded font");
+    textCacheInit(&_textCache, _font);
 
     // find levels
-    if (!_findLevels()) {
+    if (!catalogLoad(&_catalog, "levels", "pikurosu.catalog")) {
         return false;
     }
-    mtnlogMessageTag(MTNLOG_INFO, "init", "Found levels");
-
-    // start time increment task
-    int incTaskCode = pthread_create(&_incTimeThread, NULL, _timeIncrementTask, NULL);
-    if (incTaskCode != 0) {
-        mtnlogMessageTag(MTNLOG_ERROR, "init", "Failed to create time increment thread (error %d)", incTaskCode);
+    LOG_MESSAGE(MTNLOG_INFO, "init", "Found levels");
+    if (!levelListInit(&_levelList, &_catalog))
         return false;
-    }
-    
-    mtnlogMessageTag(MTNLOG_INFO, "init", "Done");
+    _setLevelListRows();
+    _levelLoadedEvent = SDL_RegisterEvents(1);
+    if (_levelLoadedEvent == (Uint32)-1 || !loaderStart(&_loader, &_catalog, _onLevelLoaded, NULL))
+        return false;
+
+    boardRendererInit(&_boardRenderer);
+    clueStateInit(&_clues);
+    frameStatsInit(&_frameStats);
+    _play.onCellChanged = _onCellChanged;
+    _play.onSolved = _onBoardSolved;
+
+    LOG_MESSAGE(MTNLOG_INFO, "init", "Done");
 
     return true;
 }
@@ -209,38 +392,69 @@ static void _onWindowEvent(SDL_Event ev)
         _screenHeight = ev.window.data2;
 
         if (_gState == GameState_Game) {
-            _setBoardPos();
+            PlayEvent pe = {PlayEvent_Resize, _screenWidth, _screenHeight, 0, 0, 0};
+            _playEvent(&pe);
         }
-
-        mtnlogMessageTag(MTNLOG_INFO, "event", "Resizing window to %dx%d", _screenWidth, _screenHeight);
+        _setLevelListRows();
+        _createFrame();
+
+        LOG_MESSAGE(MTNLOG_INFO, "event", "Resizing window to %dx%d", _screenWidth, _screenHeight);
+    } else if (ev.window.event == SDL_WINDOWEVENT_MINIMIZED) {
+        // nobody can play a minimized window
+        gameClockPause(&_solveClock);
+    } else if (ev.window.event == SDL_WINDOWEVENT_EXPOSED || ev.window.event == SDL_WINDOWEVENT_RESTORED) {
+        if (ev.window.event == SDL_WINDOWEVENT_RESTORED && _gState == GameState_Game && !_play.solved)
+            gameClockResume(&_solveClock);
+        redrawMarkAll(&_redraw);
+    } else if (ev.window.event == SDL_WINDOWEVENT_LEAVE) {
+        _mouseX = -1;
+        _mouseY = -1;
+        _updateHover();
     }
 }
 
 static void _onKeyDown(SDL_Event ev)
 {
      if (ev.key.keysym.sym == SDLK_ESCAPE) {
-         mtnlogMessageTag(MTNLOG_INFO, "event", "Pressed escape, exiting");
+         LOG_MESSAGE(MTNLOG_INFO, "event", "Pressed escape, exiting");
          _running = false;
      }
 
      if (_gState == GameState_LevelSelect) {
-        if (ev.key.keysym.sym == SDLK_UP) {
-            if (_selectedLevel > 0) {
-                _selectedLevel--;
-            }
-        } else if (ev.key.keysym.sym == SDLK_DOWN) {
-            if (_selectedLevel < _numLevels - 1) {
-                _selectedLevel++;
-            }
+        SDL_Keycode sym = ev.key.keysym.sym;
+        if (sym == SDLK_UP) {
+            _selectLevelRow(_levelList.selected - 1);
+        } else if (sym == SDLK_DOWN) {
+            _selectLevelRow(_levelList.selected + 1);
+        } else if (sym == SDLK_PAGEUP) {
+            _selectLevelRow(_levelList.selected - _levelList.numRows);
+        } else if (sym == SDLK_PAGEDOWN) {
+            _selectLevelRow(_levelList.selected + _levelList.numRows);
+        } else if (sym == SDLK_HOME) {
+            _selectLevelRow(0);
+        } else if (sym == SDLK_END) {
+            _selectLevelRow(_levelList.numShown - 1);
+        } else if (sym == SDLK_TAB) {
+            levelListSetSort(&_levelList, (LevelSort)((_levelList.sort + 1) % (LevelSort_Size + 1)));
+            redrawMarkAll(&_redraw);
+        } else if (sym == SDLK_BACKSPACE) {
+            if (levelListBackspace(&_levelList))
+                redrawMarkAll(&_redraw);
         }
 
-        if (ev.key.keysym.sym == SDLK_SPACE || ev.key.keysym.sym == SDLK_RETURN) {
-            int levelNameLen = strlen(_levelList[_selectedLevel] + strlen("levels/"));
-            char *levelName = (char *)malloc(levelNameLen * sizeof(char));
-            sprintf(levelName, "levels/%s", _levelList[_selectedLevel]);
-            _loadBoard(levelName);
-            _gState = GameState_Game;
-        }
+        // space goes into the filter once there is one
+        bool play = sym == SDLK_RETURN || (sym == SDLK_SPACE && _levelList.filter[0] == '\0');
+        if (play && levelListGetSelectedLevel(&_levelList) >= 0)
+            _playLevel(levelListGetSelectedLevel(&_levelList));
+     } else if (_gState == GameState_Game) {
+        PlayEvent pe = {PlayEvent_KeyDown, 0, 0, 0, 0, ev.key.keysym.sym};
+        if (_playEvent(&pe))
+            _onCameraMoved();
+     }
+
+     if (ev.key.keysym.sym == SDLK_F3) {
+         _showProfiler = !_showProfiler;
+         redrawMark(&_redraw, _profilerRect());
      }
 
      if (ev.key.keysym.sym == SDLK_F11) {
@@ -248,9 +462,28 @@ static void _onKeyDown(SDL_Event ev)
      }
 }
 
+static void _onTextInput(SDL_Event ev)
+{
+    if (_gState != GameState_LevelSelect)
+        return;
+    if (ev.text.text[0] == ' ' && _levelList.filter[0] == '\0')
+        return; // that space played the level
+    levelListAppendFilter(&_levelList, ev.text.text);
+    redrawMarkAll(&_redraw);
+}
+
+static void _onMouseWheel(SDL_Event ev)
+{
+    PlayEvent pe = {PlayEvent_MouseWheel, _mouseX, _mouseY, 0, 0, ev.wheel.y};
+    if (_gState == GameState_LevelSelect && levelListScroll(&_levelList, -3 * ev.wheel.y))
+        redrawMark(&_redraw, _levelListRect());
+    else if (_gState == GameState_Game && _playEvent(&pe))
+        _onCameraMoved();
+}
+
 static void _onQuitEvent(SDL_Event ev)
 {
-    mtnlogMessageTag(MTNLOG_INFO, "event", "Quit event after %d ticks, exiting", ev.quit.timestamp);
+    LOG_MESSAGE(MTNLOG_INFO, "event", "Quit event after %d ticks, exiting", ev.quit.timestamp);
     _running = false;
 }
 
@@ -258,6 +491,11 @@ static void _onMouseMotion(SDL_Event ev)
 {
     _mouseX = ev.motion.x;
     _mouseY = ev.motion.y;
+    PlayEvent pe = {PlayEvent_MouseMotion, ev.motion.x, ev.motion.y, ev.motion.xrel, ev.motion.yrel, (int32_t)ev.motion.state};
+    if (_gState == GameState_Game && _playEvent(&pe))
+        _onCameraMoved();
+    else
+        _updateHover();
 }
 
 static void _onMouseDown(SDL_Event ev)
@@ -266,62 +504,61 @@ static void _onMouseDown(SDL_Event ev)
     _mouseY = ev.button.y;
 
     switch (_gState) {
-    case GameState_Game:
-        if (ev.button.button == SDL_BUTTON_LEFT || ev.button.button == SDL_BUTTON_RIGHT) {
-            if (_boardSolved)
-                break; // can't interact with board after solved
-            for (int i = 0; i < _board.size; i++) {
-                for (int j = 0; j < _board.size; j++) {
-                    int cellX = i * CELL_SIZE + _boardX;
-                    int cellY = j * CELL_SIZE + _boardY;
-                    bool hovering = (_mouseX > cellX && _mouseY > cellY && _mouseX < cellX + CELL_SIZE && _mouseY < cellY + CELL_SIZE);
-                    if (hovering) {
-                        mtnlogMessageTag(MTNLOG_INFO, "event", "Clicked on cell (%d,%d)", i, j);
-                        CellState oldState = boardGetCell(&_board, i, j);
-
-                        Uint8 button = ev.button.button;
-                        bool didMove = false;
-                        switch (button) {
-                        case SDL_BUTTON_LEFT:
-                            if (oldState == CellState_Filled) {
-                                boardSetCell(&_board, i, j, CellState_Empty);
-                                didMove = true;
-                            } else if (oldState == CellState_Empty) {
-                                boardSetCell(&_board, i, j, CellState_Filled);
-                                didMove = true;
-                            }
-                            break;
-                        case SDL_BUTTON_RIGHT:
-                            if (oldState == CellState_Cross) {
-                                boardSetCell(&_board, i, j, CellState_Empty);
-                                didMove = true;
-                            } else if (oldState == CellState_Empty) {
-                                boardSetCell(&_board, i, j, CellState_Cross);
-                                didMove = true;
-                            }
-                            break;
-                        }
-
-                        if (didMove && boardIsSolved(&_board)) {
-                            mtnlogMessageTag(MTNLOG_INFO, "event", "Board is solved");
-                            _boardSolved = true;
-                            _incTime = false;
-                            mtnlogMessageTag(MTNLOG_INFO, "event", "Solve time: %d ms (%.2f s)", _time, (float)_time / 1000);
-                        }
-                    }
-                }
-            }
+    case GameState_LevelSelect:
+        if (ev.button.button == SDL_BUTTON_LEFT && _mouseY >= LEVEL_LIST_TOP) {
+            int row = _levelList.first + (_mouseY - LEVEL_LIST_TOP) / LEVEL_LIST_ROW_HEIGHT;
+            if (row < _levelList.first + _levelList.numRows && row < _levelList.numShown)
+                _selectLevelRow(row);
         }
         break;
+    case GameState_Game: {
+        PlayEvent pe = {PlayEvent_MouseDown, ev.button.x, ev.button.y, 0, 0, ev.button.button};
+        _playEvent(&pe);
+        break;
+    }
     default:
         break;
     }
 }
 
+static void _onMouseUp(SDL_Event ev)
+{
+    PlayEvent pe = {PlayEvent_MouseUp, ev.button.x, ev.button.y, 0, 0, ev.button.button};
+    if (_gState == GameState_Game)
+        _playEvent(&pe);
+}
+
+// How long the loop may sleep before the timer or the profiler overlay on
+// screen needs to change, or not at all while level metadata is loading
+static int _nextTimeout(void)
+{
+    if (_gState == GameState_LevelSelect && levelListNeedsMeta(&_levelList))
+        return 0;
+    int timeout = -1;
+    if (_gState == GameState_Game && gameClockIsRunning(&_solveClock))
+        timeout = 10 - (int)(gameClockElapsedMs(&_solveClock) % 10);
+    if (_showProfiler) {
+        int sinceShown = (int)((monotonicNs() - _profilerShownNs) / 1000000);
+        int untilRefresh = sinceShown < PROFILER_REFRESH_MS ? PROFILER_REFRESH_MS - sinceShown : 0;
+        if (timeout < 0 || untilRefresh < timeout)
+            timeout = untilRefresh;
+    }
+    return timeout;
+}
+
+// Sleeps until there is an event or the timer needs redrawing, then handles
+// everything that queued up
 static void _handleEvents(void)
 {
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
+    int timeout = _nextTimeout();
+    if (redrawPending(&_redraw))
+        timeout = 0;
+    int got = timeout < 0 ? SDL_WaitEvent(&ev) : SDL_WaitEventTimeout(&ev, timeout);
+
+    // waiting is idle time, only handling counts
+    PROFILE_BEGIN(scope, "events");
+    for (; got; got = SDL_PollEvent(&ev)) {
         switch (ev.type) {
         case SDL_WINDOWEVENT:
             _onWindowEvent(ev);
@@ -329,6 +566,12 @@ static void _handleEvents(void)
         case SDL_KEYDOWN:
             _onKeyDown(ev);
             break;
+        case SDL_TEXTINPUT:
+            _onTextInput(ev);
+            break;
+        case SDL_MOUSEWHEEL:
+            _onMouseWheel(ev);
+            break;
         case SDL_QUIT:
             _onQuitEvent(ev);
             break;
@@ -338,66 +581,97 @@ static void _handleEvents(void)
         case SDL_MOUSEBUTTONDOWN:
             _onMouseDown(ev);
             break;
+        case SDL_MOUSEBUTTONUP:
+            _onMouseUp(ev);
+            break;
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+            // the frame texture and all text textures lost their contents
+            levelListInvalidate(&_levelList);
+            boardRendererResetTextures(&_boardRenderer);
+            textCacheInvalidate(&_textCache);
+            redrawMarkAll(&_redraw);
+            break;
+        default:
+            if (ev.type == _levelLoadedEvent && ev.user.code == _pendingLevel)
+                _startPendingLevel();
+            break;
         }
     }
+    PROFILE_END(scope);
 }
 
 static void _update(void)
 {
     _handleEvents();
+    if (_gState == GameState_LevelSelect) {
+        if (levelListLoadMeta(&_levelList, LEVEL_LIST_META_BUDGET_MS))
+            redrawMarkAll(&_redraw);
+        _prefetchAroundSelection();
+    }
+
+    int shownTime = (int)(gameClockElapsedMs(&_solveClock) / 10);
+    if (_gState == GameState_Game && shownTime != _shownTime) {
+        _shownTime = shownTime;
+        redrawMark(&_redraw, _timeTextRect());
+    }
+
+    uint64_t now = monotonicNs();
+    if (_showProfiler && now - _profilerShownNs >= (uint64_t)PROFILER_REFRESH_MS * 1000000) {
+        _profilerShownNs = now;
+        redrawMark(&_redraw, _profilerRect());
+    }
 }
 
 static void _renderBoard(void)
 {
-    for (int i = 0; i < _board.size; i++) {
-        for (int j = 0; j < _board.size; j++) {
-            int cellX = i * CELL_SIZE + _boardX;
-            int cellY = j * CELL_SIZE + _boardY;
-            SDL_Rect cellRect = {cellX, cellY, CELL_SIZE, CELL_SIZE};
-            SDL_Rect cellFilledRect = {cellX + 4, cellY + 4, CELL_SIZE - 8, CELL_SIZE - 8};
-
-            bool hovering = (_mouseX > cellX && _mouseY > cellY && _mouseX < cellX + CELL_SIZE && _mouseY < cellY + CELL_SIZE);
-            bool hoveringOnlyX = (_mouseX > cellX && _mouseX < cellX + CELL_SIZE);
-            bool hoveringOnlyY = (_mouseY > cellY && _mouseY < cellY + CELL_SIZE);
-            bool mouseInBoard = (_mouseX > _boardX && _mouseY > _boardY && _mouseX < _boardX + _board.size * CELL_SIZE && _mouseY < _boardY + _board.size * CELL_SIZE);
-
-            if (hovering)
-                SDL_SetRenderDrawColor(_rend, 230, 230, 230, 255);
-            else if ((hoveringOnlyX || hoveringOnlyY) && mouseInBoard)
-                SDL_SetRenderDrawColor(_rend, 160, 160, 160, 255);
-            else
-                SDL_SetRenderDrawColor(_rend, 128, 128, 128, 255);
-            SDL_RenderFillRect(_rend, &cellRect);
-            if (hovering)
-                SDL_SetRenderDrawColor(_rend, 0, 0, 255, 255);
-            else
-                SDL_SetRenderDrawColor(_rend, 0, 0, 128, 255);
-            SDL_RenderDrawRect(_rend, &cellRect);
-
-            CellState state = boardGetCell(&_board, i, j);
-            switch (state) {
-            default:
-                break;
-            case CellState_Filled:
-                if (hovering)
-                    SDL_SetRenderDrawColor(_rend, 120, 120, 120, 255);
-                else
-                    SDL_SetRenderDrawColor(_rend, 80, 80, 80, 255);
-                SDL_RenderFillRect(_rend, &cellFilledRect);
-                break;
-            case CellState_Cross:
-                if (hovering)
-                    SDL_SetRenderDrawColor(_rend, 120, 120, 120, 255);
-                else
-                    SDL_SetRenderDrawColor(_rend, 80, 80, 80, 255);
-                for (int k = -1; k <= 2; k++) {
-                    int cx = cellX + k;
-                    SDL_RenderDrawLine(_rend, cx + 6, cellY + 6, cx + CELL_SIZE - 8, cellY + CELL_SIZE - 8);
-                    SDL_RenderDrawLine(_rend, cx + 6, cellY + CELL_SIZE - 8, cx + CELL_SIZE - 8, cellY + 6);
-                }
-                break;
-            }
-        }
+    boardRendererDraw(&_boardRenderer, _rend, &_level->board, &_play.camera, _hoverX, _hoverY);
+}
+
+static void _renderClue(int x, int y, float scale, int clue, bool done)
+{
+    int cs = _play.camera.cellSize;
+    // 4 digit clues only show up on the largest boards and get squeezed in
+    if (clue >= 1000)
+        scale *= 0.75f;
+    SDL_Color color = done ? FC_MakeColor(90, 90, 90, 255) : FC_MakeColor(255, 255, 255, 255);
+    FC_Effect eff = FC_MakeEffect(FC_ALIGN_CENTER, FC_MakeScale(scale, scale), color);
+    FC_DrawEffect(_font, _rend, x + cs / 2, y + (cs - FC_GetLineHeight(_font) * scale) / 2, eff, "%d", clue);
+}
+
+// Only the visible lines that reach into the clip rect get drawn, so a move
+// redraws the clues of one row and one column and not every clue on screen
+static void _renderClues(void)
+{
+    const Camera *camera = &_play.camera;
+    int cs = camera->cellSize;
+    if (cs < CLUE_MIN_CELL_SIZE)
+        return;
+    SDL_Rect clip = {0, 0, _screenWidth, _screenHeight};
+    if (SDL_RenderIsClipEnabled(_rend))
+        SDL_RenderGetClipRect(_rend, &clip);
+    SDL_Rect cells = cameraVisibleCells(camera);
+    float scale = cs * 0.6f / FC_GetLineHeight(_font);
+
+    for (int y = cells.y; y < cells.y + cells.h; y++) {
+        SDL_Rect rect = _rowCluesRect(y);
+        if (!SDL_HasIntersection(&rect, &clip))
+            continue;
+        int count;
+        const int *clues = hintsGetRow(&_level->hints, y, &count);
+        const bool *done = clueStateGetRow(&_clues, y);
+        for (int i = 0; i < count; i++)
+            _renderClue(camera->boardX - (count - i) * cs, rect.y, scale, clues[i], done[i]);
+    }
+    for (int x = cells.x; x < cells.x + cells.w; x++) {
+        SDL_Rect rect = _colCluesRect(x);
+        if (!SDL_HasIntersection(&rect, &clip))
+            continue;
+        int count;
+        const int *clues = hintsGetCol(&_level->hints, x, &count);
+        const bool *done = clueStateGetCol(&_clues, x);
+        for (int i = 0; i < count; i++)
+            _renderClue(rect.x, camera->boardY - (count - i) * cs, scale, clues[i], done[i]);
     }
 }
 
@@ -406,7 +680,7 @@ static void _renderTimeText(void)
     SDL_Color color;
     color.a = 255;
 
-    if (_boardSolved) {
+    if (_play.solved) {
         // set color to green if solved
         color.r = 0;
         color.g = 210;
@@ -417,15 +691,12 @@ static void _renderTimeText(void)
         color.g = 255;
         color.b = 255;
     }
-    FC_DrawColor(_font, _rend, 10, 10, color, "Time: %.2f s", (float)_time / 1000);
+    textCacheDraw(&_textCache, _rend, 10, 10, 1.0f, color, "Time: %.2f s", _shownTime / 100.0);
 }
 
 static void _renderBoardMeta(void)
 {
-    FC_Scale scale;
-    scale.x = 0.5f;
-    scale.y = 0.5f;
-    FC_DrawScale(_font, _rend, 10, _screenHeight - 22, scale, "%s by %s", _boardMeta.name, _boardMeta.author);
+    textCacheDraw(&_textCache, _rend, 10, _screenHeight - 22, 0.5f, FC_MakeColor(255, 255, 255, 255), "%s by %s", _level->meta.name, _level->meta.author);
 }
 
 static void _renderLevelSelectHeading(void)
@@ -435,110 +706,189 @@ static void _renderLevelSelectHeading(void)
     headingColor.g = 255;
     headingColor.b = 255;
     headingColor.a = 255;
-    FC_DrawColor(_font, _rend, 10, 10, headingColor, "Select a level");
+    SDL_Rect heading = textCacheDraw(&_textCache, _rend, 10, 10, 1.0f, headingColor, "Select a level");
+
+    textCacheDraw(&_textCache, _rend, heading.x + heading.w + 20, 20, 0.5f, FC_MakeColor(190, 190, 190, 255), "%d of %d, sorted by %s%s%s%s%s", _levelList.numShown, catalogGetNumEntries(&_catalog),
+        levelListSortString(_levelList.sort), _levelList.filter[0] ? ", filter: " : "", _levelList.filter, levelListNeedsMeta(&_levelList) ? ", reading levels..." : "",
+        _pendingLevel >= 0 ? ", loading..." : "");
 }
 
 static void _renderLevelList(void)
 {
-    FC_Scale scale;
-
-    scale.x = 0.75f;
-    scale.y = 0.75f;
-
-    for (int i = 0; i < _numLevels; i++) {
-        FC_Effect eff;
-        SDL_Color color;
-        color.a = 255;
-
-        if (_selectedLevel == i) {
-            color.r = 0;
-            color.g = 255;
-            color.b = 0;
-        } else {
-            color.r = color.g = color.b = 255;
-        }
-
-        eff = FC_MakeEffect(FC_ALIGN_LEFT, scale, color);
-        FC_DrawEffect(_font, _rend, 14, 40 + 23 * i, eff, "%s", _levelList[i]);
-    }
+    levelListDraw(&_levelList, _rend, _font, 14, LEVEL_LIST_TOP);
 }
 
 static void _renderLevelSelectTooltips(void)
 {
-    FC_Effect eff;
-    FC_Scale scale;
     SDL_Color color;
     color.r = 190;
     color.g = 190;
     color.b = 190;
     color.a = 255;
-    scale.x = 0.5f;
-    scale.y = 0.5f;
-    eff = FC_MakeEffect(FC_ALIGN_LEFT, scale, color);
-    FC_DrawEffect(_font, _rend, 10, _screenHeight - 34, eff, "Arrows: select level");
-    FC_DrawEffect(_font, _rend, 10, _screenHeight - 22, eff, "Space or Enter: play level");
+    textCacheDraw(&_textCache, _rend, 10, _screenHeight - 34, 0.5f, color, "Arrows, Page Up/Down, wheel: select level. Type to filter, Tab: change sorting");
+    textCacheDraw(&_textCache, _rend, 10, _screenHeight - 22, 0.5f, color, "Space or Enter: play level");
 }
 
-static void _render(void)
+// Per frame averages over the last second, frames being the ones drawn by
+// _render
+static void _renderProfiler(void)
 {
-    // clear screen
+    uint64_t since = monotonicNs() - 1000000000ull;
+    int frames;
+    profilerTotalMs("frame", since, &frames);
+    double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+    double events = profilerTotalMs("events", since, NULL) * perFrame;
+    double board = profilerTotalMs("board", since, NULL) * perFrame;
+    double text = profilerTotalMs("text", since, NULL) * perFrame;
+    double present = profilerTotalMs("present", since, NULL) * perFrame;
+
+    SDL_Rect rect = _profilerRect();
     SDL_SetRenderDrawColor(_rend, 0, 0, 0, 255);
-    SDL_RenderClear(_rend);
+    SDL_RenderFillRect(_rend, &rect);
+
+    FC_Effect eff = FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(0.5f, 0.5f), FC_MakeColor(255, 255, 0, 255));
+    int x = rect.x + 4;
+    int y = rect.y + 4;
+    FC_DrawEffect(_font, _rend, x, y, eff, "frame p50 %.2f ms, p99 %.2f ms, %d fps", frameStatsPercentileMs(&_frameStats, 50.0),
+        frameStatsPercentileMs(&_frameStats, 99.0), frames);
+    y += PROFILER_OVERLAY_LINE_HEIGHT;
+    FC_DrawEffect(_font, _rend, x, y, eff, "events %.2f ms, board %.2f ms", events, board);
+    y += PROFILER_OVERLAY_LINE_HEIGHT;
+    FC_DrawEffect(_font, _rend, x, y, eff, "text %.2f ms, present %.2f ms", text, present);
+    y += PROFILER_OVERLAY_LINE_HEIGHT;
+    FC_DrawEffect(_font, _rend, x, y, eff, "last level load %.2f ms", _loadMs);
+    y += PROFILER_OVERLAY_LINE_HEIGHT;
+    FC_DrawEffect(_font, _rend, x, y, eff, "%llu allocations, %.1f KiB", (unsigned long long)profilerGetAllocs(), profilerGetAllocBytes() / 1024.0);
+}
+
+static void _renderScene(void)
+{
+    // clear screen, SDL_RenderClear would ignore the clip rect
+    SDL_SetRenderDrawColor(_rend, 0, 0, 0, 255);
+    SDL_RenderFillRect(_rend, NULL);
 
     switch (_gState) {
-    case GameState_Game:
+    case GameState_Game: {
+        PROFILE_BEGIN(boardScope, "board");
         _renderBoard();
+        PROFILE_END(boardScope);
+        PROFILE_BEGIN(textScope, "text");
+        _renderClues();
         _renderTimeText();
         _renderBoardMeta();
+        PROFILE_END(textScope);
         break;
-    case GameState_LevelSelect:
+    }
+    case GameState_LevelSelect: {
+        PROFILE_BEGIN(textScope, "text");
         _renderLevelSelectHeading();
         _renderLevelSelectTooltips();
         _renderLevelList();
+        PROFILE_END(textScope);
         break;
     }
+    }
+
+    if (_showProfiler) {
+        PROFILE_BEGIN(textScope, "text");
+        _renderProfiler();
+        PROFILE_END(textScope);
+    }
+}
+
+// Redraws the dirty regions into the frame texture and presents it. Nothing
+// gets drawn or presented when nothing changed.
+static void _render(void)
+{
+    if (!redrawPending(&_redraw))
+        return;
+    frameStatsBegin(&_frameStats);
+    PROFILE_BEGIN(frameScope, "frame");
+
+    // label textures have to be rendered before the frame texture is the
+    // target
+    if (_gState == GameState_LevelSelect)
+        levelListPrepare(&_levelList, _rend, _font);
+
+    if (!_frame) {
+        _renderScene();
+    } else {
+        SDL_SetRenderTarget(_rend, _frame);
+        if (_redraw.full) {
+            _renderScene();
+        } else {
+            for (int i = 0; i < _redraw.numRegions; i++) {
+                SDL_RenderSetClipRect(_rend, &_redraw.regions[i]);
+                _renderScene();
+            }
+            SDL_RenderSetClipRect(_rend, NULL);
+        }
+        SDL_SetRenderTarget(_rend, NULL);
+        SDL_RenderCopy(_rend, _frame, NULL, NULL);
+    }
 
     // put stuff to screen
+    PROFILE_BEGIN(presentScope, "present");
     SDL_RenderPresent(_rend);
+    PROFILE_END(presentScope);
+    redrawClear(&_redraw);
+    PROFILE_END(frameScope);
+    frameStatsEnd(&_frameStats);
 }
 
 static void _cleanup(void)
 {
-    // free level list
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "Freeing level list");
-    for (int i = 0; i < _numLevels; i++)
-        free(_levelList[i]);
-
-    // destroy board, its metadata and hints
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "Destroying board");
-    boardDestroy(&_board);
-    boardMetaDestroy(&_boardMeta);
-    hintsDestroy(&_hints);
+    // finish the recording, then stop loading before the catalog goes away
+    if (_level && _recording.fp)
+        replayWriterClose(&_recording, &_level->board);
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "Stopping level loader");
+    loaderStop(&_loader);
+    _level = NULL;
+
+    // save and free level catalog
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "Freeing level catalog");
+    levelListDestroy(&_levelList);
+    catalogSave(&_catalog);
+    catalogDestroy(&_catalog);
+
+    boardRendererDestroy(&_boardRenderer);
+    clueStateDestroy(&_clues);
+
+    // dump and free profiler data
+    if (argsGetTraceFile())
+        profilerWriteTrace(argsGetTraceFile());
+    profilerShutdown();
 
     // do some args cleanup
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "Doing args cleanup");
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "Doing args cleanup");
     argsCleanup();
 
-    // stop threads
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "Stopping threads");
-    _incTaskRunning = false;
-    pthread_join(_incTimeThread, NULL);
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "Drew %ld frames, last %d took %.2f ms on average and %.2f ms at most",
+        _frameStats.numFrames, _frameStats.numSamples, frameStatsAverageMs(&_frameStats), frameStatsMaxMs(&_frameStats));
 
     // unload fonts
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "Unloading fonts");
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "Unloading fonts");
+    textCacheDestroy(&_textCache);
     FC_FreeFont(_font);
 
     // destroy SDL stuff
-    mtnlogMessageTag(MTNLOG_INFO, "cleanup", "SDL cleanup");
+    LOG_MESSAGE(MTNLOG_INFO, "cleanup", "SDL cleanup");
+    if (_frame)
+        SDL_DestroyTexture(_frame);
     SDL_DestroyRenderer(_rend);
     SDL_DestroyWindow(_window);
     SDL_Quit();
+
+    // write out what's still queued
+    loggerStop();
 }
 
-void gameRun(int argc, char **argv)
+void gameRun(void)
 {
-    if (!_init(argc, argv))
+    if (!_init()) {
+        loggerStop();
         return;
+    }
     while (_running) {
         _update();
         _render();
@@ -0,0 +1,125 @@
+#include "gameclock.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+void gameClockStart(GameClock *clock)
+{
+    clock->startNs = monotonicNs();
+    clock->elapsedNs = 0;
+    clock->lapNs = 0;
+    clock->running = true;
+}
+
+// Stops and resets the clock
+void gameClockStop(GameClock *clock)
+{
+    memset(clock, 0, sizeof(GameClock));
+}
+
+void gameClockPause(GameClock *clock)
+{
+    if (!clock->running)
+        return;
+    clock->elapsedNs += monotonicNs() - clock->startNs;
+    clock->running = false;
+}
+
+void gameClockResume(GameClock *clock)
+{
+    if (clock->running)
+        return;
+    clock->startNs = monotonicNs();
+    clock->running = true;
+}
+
+bool gameClockIsRunning(GameClock *clock)
+{
+    return clock->running;
+}
+
+uint64_t gameClockElapsedNs(GameClock *clock)
+{
+    if (!clock->running)
+        return clock->elapsedNs;
+    return clock->elapsedNs + (monotonicNs() - clock->startNs);
+}
+
+int64_t gameClockElapsedMs(GameClock *clock)
+{
+    return (int64_t)(gameClockElapsedNs(clock) / 1000000);
+}
+
+// Returns the time since the previous lap, or since the start for the first one
+uint64_t gameClockLap(GameClock *clock)
+{
+    uint64_t now = gameClockElapsedNs(clock);
+    uint64_t lap = now - clock->lapNs;
+    clock->lapNs = now;
+    return lap;
+}
+
+void frameStatsInit(FrameStats *stats)
+{
+    memset(stats, 0, sizeof(FrameStats));
+}
+
+void frameStatsBegin(FrameStats *stats)
+{
+    stats->frameStartNs = monotonicNs();
+}
+
+void frameStatsEnd(FrameStats *stats)
+{
+    stats->samples[stats->next] = monotonicNs() - stats->frameStartNs;
+    stats->next = (stats->next + 1) % FRAME_STATS_SAMPLES;
+    if (stats->numSamples < FRAME_STATS_SAMPLES)
+        stats->numSamples++;
+    stats->numFrames++;
+}
+
+double frameStatsAverageMs(FrameStats *stats)
+{
+    if (stats->numSamples == 0)
+        return 0.0;
+    uint64_t total = 0;
+    for (int i = 0; i < stats->numSamples; i++)
+        total += stats->samples[i];
+    return total / 1e6 / stats->numSamples;
+}
+
+double frameStatsMaxMs(FrameStats *stats)
+{
+    uint64_t most = 0;
+    for (int i = 0; i < stats->numSamples; i++) {
+        if (stats->samples[i] > most)
+            most = stats->samples[i];
+    }
+    return most / 1e6;
+}
+
+double frameStatsLastMs(FrameStats *stats)
+{
+    if (stats->numSamples == 0)
+        return 0.0;
+    return stats->samples[(stats->next + FRAME_STATS_SAMPLES - 1) % FRAME_STATS_SAMPLES] / 1e6;
+}
+
+static int _compareSamples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// percentile is between 0 and 100
+double frameStatsPercentileMs(FrameStats *stats, double percentile)
+{
+    if (stats->numSamples == 0)
+        return 0.0;
+    uint64_t sorted[FRAME_STATS_SAMPLES];
+    memcpy(sorted, stats->samples, stats->numSamples * sizeof(uint64_t));
+    qsort(sorted, stats->numSamples, sizeof(uint64_t), _compareSamples);
+    int index = (int)(percentile / 100.0 * (stats->numSamples - 1) + 0.5);
+    return sorted[index] / 1e6;
+}
@@ -0,0 +1,193 @@
+#include "generator.h"
+#include "bitset.h"
+#include "hints.h"
+#include "pool.h"
+#include "solver.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Scratch buffers owned by one worker thread
+typedef struct s_generator_scratch {
+    Solver solver;
+    uint64_t *rows;
+    uint64_t *cols;
+    bool ready;
+} GeneratorScratch;
+
+typedef struct s_generator {
+    GeneratorOptions *options;
+    GeneratedLevels *levels;
+    GeneratorScratch *scratch;
+    long *attempts; // per level so workers never share a counter
+} Generator;
+
+// splitmix64, seeded per level
+static uint64_t _nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static bool _initScratch(GeneratorScratch *scratch, int size)
+{
+    size_t planeWords = (size_t)size * BITSET_WORDS(size);
+    if (!solverCreate(&scratch->solver, size))
+        return false;
+    scratch->rows = (uint64_t *)malloc(2 * planeWords * sizeof(uint64_t));
+    if (!scratch->rows) {
+        solverDestroy(&scratch->solver);
+        return false;
+    }
+    scratch->cols = scratch->rows + planeWords;
+    scratch->ready = true;
+    return true;
+}
+
+static void _sampleGrid(GeneratorScratch *scratch, int size, uint64_t threshold, uint64_t *rng)
+{
+    int wpl = BITSET_WORDS(size);
+    memset(scratch->rows, 0, 2 * (size_t)size * wpl * sizeof(uint64_t));
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (_nextRandom(rng) < threshold) {
+                bitsetSet(scratch->rows + y * wpl, x);
+                bitsetSet(scratch->cols + x * wpl, y);
+            }
+        }
+    }
+}
+
+// Every line gets solved at least once, so easy levels need barely more than
+// a single sweep
+static bool _inBand(GeneratorDifficulty difficulty, long steps, int size)
+{
+    double perLine = steps / (2.0 * size);
+    switch (difficulty) {
+    case GeneratorDifficulty_Easy:
+        return perLine < 2.0;
+    case GeneratorDifficulty_Medium:
+        return perLine >= 2.0 && perLine < 3.0;
+    case GeneratorDifficulty_Hard:
+        return perLine >= 3.0;
+    default:
+        return true;
+    }
+}
+
+static void _packGrid(GeneratorScratch *scratch, int size, unsigned char *bits)
+{
+    int wpl = BITSET_WORDS(size);
+    memset(bits, 0, boardPackedSize(size));
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            size_t i = (size_t)y * size + x;
+            if (bitsetGet(scratch->rows + y * wpl, x))
+                bits[i >> 3] |= 1 << (i & 7);
+        }
+    }
+}
+
+static void _generateTask(void *arg, int index, int worker)
+{
+    Generator *gen = (Generator *)arg;
+    GeneratorOptions *options = gen->options;
+    GeneratorScratch *scratch = &gen->scratch[worker];
+    int size = options->size;
+    if (!scratch->ready && !_initScratch(scratch, size))
+        return;
+
+    uint64_t rng = options->seed ^ ((uint64_t)index * 0xd1b54a32d192ed03ull);
+    uint64_t threshold = options->density >= 1.0 ? UINT64_MAX : (uint64_t)(options->density * 18446744073709551616.0);
+    for (int attempt = 0; attempt < options->maxAttempts; attempt++) {
+        gen->attempts[index]++;
+        _sampleGrid(scratch, size, threshold, &rng);
+
+        BoardHints hints;
+        if (!hintsCreateFromPlanes(&hints, scratch->rows, scratch->cols, size))
+            return;
+        Solver *solver = &scratch->solver;
+        solverReset(solver);
+        long steps = solver->steps;
+        SolveResult result = solverSolve(solver, &hints);
+        hintsDestroy(&hints);
+
+        if (result == SolveResult_Solved && _inBand(options->difficulty, solver->steps - steps, size)) {
+            _packGrid(scratch, size, gen->levels->bits + index * boardPackedSize(size));
+            gen->levels->found[index] = true;
+            return;
+        }
+    }
+}
+
+bool generatorRun(GeneratorOptions *options, int count, GeneratedLevels *levels)
+{
+    memset(levels, 0, sizeof(GeneratedLevels));
+    if (options->size <= 0 || options->size > BOARD_MAX_SIZE || count <= 0) {
+        LOG_MESSAGE(MTNLOG_ERROR, "generator", "Invalid size %d or level count %d", options->size, count);
+        return false;
+    }
+
+    int numThreads = options->numThreads > 0 ? options->numThreads : poolDefaultThreads();
+    levels->count = count;
+    levels->size = options->size;
+    levels->bits = (unsigned char *)malloc(count * boardPackedSize(options->size));
+    levels->found = (bool *)calloc(count, sizeof(bool));
+
+    Generator gen;
+    gen.options = options;
+    gen.levels = levels;
+    gen.scratch = (GeneratorScratch *)calloc(numThreads, sizeof(GeneratorScratch));
+    gen.attempts = (long *)calloc(count, sizeof(long));
+
+    bool ok = levels->bits && levels->found && gen.scratch && gen.attempts;
+    if (ok)
+        ok = poolRun(numThreads, count, _generateTask, &gen);
+    else
+        LOG_MESSAGE(MTNLOG_ERROR, "generator", "Failed to allocate memory for %d levels", count);
+
+    for (int i = 0; ok && i < count; i++)
+        levels->attempts += gen.attempts[i];
+    for (int i = 0; gen.scratch && i < numThreads; i++) {
+        if (gen.scratch[i].ready) {
+            solverDestroy(&gen.scratch[i].solver);
+            free(gen.scratch[i].rows);
+        }
+    }
+    free(gen.scratch);
+    free(gen.attempts);
+    if (!ok)
+        generatorDestroy(levels);
+    return ok;
+}
+
+bool generatorLoadLevel(GeneratedLevels *levels, int index, Board *board)
+{
+    if (index < 0 || index >= levels->count || !levels->found[index])
+        return false;
+    return boardLoadPacked(board, levels->bits + index * boardPackedSize(levels->size), levels->size);
+}
+
+void generatorDestroy(GeneratedLevels *levels)
+{
+    free(levels->bits);
+    free(levels->found);
+    memset(levels, 0, sizeof(GeneratedLevels));
+}
+
+const char *generatorDifficultyString(GeneratorDifficulty difficulty)
+{
+    switch (difficulty) {
+    case GeneratorDifficulty_Any:
+        return "any";
+    case GeneratorDifficulty_Easy:
+        return "easy";
+    case GeneratorDifficulty_Medium:
+        return "medium";
+    case GeneratorDifficulty_Hard:
+        return "hard";
+    }
+    return "unknown";
+}
@@ -1,52 +1,229 @@
 #include "hints.h"
-#include "mtnlog.h"
+#include "bitset.h"
+#include "logger.h"
 #include <stdlib.h>
+#include <string.h>
 
-bool hintsCreate(BoardHints *hints, int boardSize)
+// Bit tricks for runs in a packed line: a cell starts a run if it is filled
+// and the cell before it isn't, and ends one if the cell after it isn't.
+static uint64_t _runStarts(const uint64_t *line, int w)
 {
+    uint64_t prevTop = w > 0 ? line[w - 1] >> 63 : 0;
+    return line[w] & ~((line[w] << 1) | prevTop);
+}
+
+static uint64_t _runEnds(const uint64_t *line, int w, int wpl)
+{
+    uint64_t nextLow = w + 1 < wpl ? line[w + 1] & 1 : 0;
+    return line[w] & ~((line[w] >> 1) | (nextLow << 63));
+}
+
+static int _countRuns(const uint64_t *line, int wpl)
+{
+    int count = 0;
+    for (int w = 0; w < wpl; w++)
+        count += __builtin_popcountll(_runStarts(line, w));
+    return count;
+}
+
+// The i-th run start always pairs with the i-th run end, so starts are written
+// first and each end turns its start position into a length. Returns the
+// number of runs.
+static int _extractRuns(const uint64_t *line, int wpl, int *out)
+{
+    int numStarts = 0;
+    int numEnds = 0;
+    for (int w = 0; w < wpl; w++) {
+        uint64_t starts = _runStarts(line, w);
+        uint64_t ends = _runEnds(line, w, wpl);
+        while (starts) {
+            out[numStarts++] = w * 64 + __builtin_ctzll(starts);
+            starts &= starts - 1;
+        }
+        while (ends) {
+            out[numEnds] = w * 64 + __builtin_ctzll(ends) - out[numEnds] + 1;
+            numEnds++;
+            ends &= ends - 1;
+        }
+    }
+    return numEnds;
+}
+
+static int *_allocLines(BoardHints *hints, size_t count)
+{
+    if (hints->arena)
+        return (int *)arenaAlloc(hints->arena, count * sizeof(int));
+    return (int *)malloc(count * sizeof(int));
+}
+
+static bool _createFromPlanes(BoardHints *hints, const uint64_t *rows, const uint64_t *cols, int boardSize, Arena *arena)
+{
+    hints->lines = NULL;
+    hints->data = NULL;
+    hints->arena = arena;
+
     if (boardSize <= 0) {
-        mtnlogMessageTag(MTNLOG_ERROR, "hints", "Invalid board size %d", boardSize);
+        LOG_MESSAGE(MTNLOG_ERROR, "hints", "Invalid board size %d", boardSize);
         return false;
     }
 
     hints->boardSize = boardSize;
+    int wpl = BITSET_WORDS(boardSize);
 
-    hints->rows = (int **)malloc(boardSize * sizeof(int *));
-    hints->cols = (int **)malloc(boardSize * sizeof(int *));
+    // count the runs first so offsets and clues fit in a single allocation
+    size_t total = 0;
+    for (int i = 0; i < boardSize; i++) {
+        total += 1 + _countRuns(rows + i * wpl, wpl);
+        total += 1 + _countRuns(cols + i * wpl, wpl);
+    }
 
-    if (!hints->rows || !hints->cols) {
-        mtnlogMessageTag(MTNLOG_ERROR, "hints", "Failed to create board hints");
+    hints->lines = _allocLines(hints, 2 * boardSize + total);
+    if (!hints->lines) {
+        LOG_MESSAGE(MTNLOG_ERROR, "hints", "Failed to create board hints");
         return false;
     }
+    hints->data = hints->lines + 2 * boardSize;
+
+    int offset = 0;
+    for (int i = 0; i < 2 * boardSize; i++) {
+        const uint64_t *line = i < boardSize ? rows + i * wpl : cols + (i - boardSize) * wpl;
+        hints->lines[i] = offset;
+        int count = _extractRuns(line, wpl, hints->data + offset + 1);
+        hints->data[offset] = count;
+        offset += 1 + count;
+    }
+
+    LOG_MESSAGE(MTNLOG_INFO, "hints", "Created hints for board of size %d", boardSize);
+    return true;
+}
+
+bool hintsCreateFromPlanes(BoardHints *hints, const uint64_t *rows, const uint64_t *cols, int boardSize)
+{
+    return _createFromPlanes(hints, rows, cols, boardSize, NULL);
+}
 
-    for (int i = 0; i < boardSize; ++i) {
-        hints->rows[i] = (int *)malloc(MAX_HINTS(boardSize) * sizeof(int));
-        hints->cols[i] = (int *)malloc(MAX_HINTS(boardSize) * sizeof(int));
-        if (!hints->rows[i] || !hints->cols[i]) {
-            mtnlogMessageTag(MTNLOG_ERROR, "hints", "Failed to create board hints");
+bool hintsCreateFromClues(BoardHints *hints, const uint16_t *clues, size_t len, int boardSize)
+{
+    return hintsCreateFromCluesArena(hints, clues, len, boardSize, NULL);
+}
+
+// The solver and the clue tracking size their buffers by MAX_HINTS and rely on
+// every clue fitting on the board with a gap before the next one
+static bool _validLine(const uint16_t *clues, int count, int boardSize)
+{
+    if (count > MAX_HINTS(boardSize))
+        return false;
+    int cells = count > 0 ? count - 1 : 0;
+    for (int i = 0; i < count; i++) {
+        if (clues[i] == 0 || clues[i] > boardSize)
+            return false;
+        cells += clues[i];
+    }
+    return cells <= boardSize;
+}
+
+// clues is laid out like BoardHints::data: every row, then every column, each
+// as its clue count followed by the clues
+bool hintsCreateFromCluesArena(BoardHints *hints, const uint16_t *clues, size_t len, int boardSize, Arena *arena)
+{
+    hints->lines = NULL;
+    hints->data = NULL;
+    hints->boardSize = boardSize;
+    hints->arena = arena;
+
+    if (boardSize <= 0) {
+        LOG_MESSAGE(MTNLOG_ERROR, "hints", "Invalid board size %d", boardSize);
+        return false;
+    }
+
+    hints->lines = _allocLines(hints, 2 * boardSize + len);
+    if (!hints->lines) {
+        LOG_MESSAGE(MTNLOG_ERROR, "hints", "Failed to create board hints");
+        return false;
+    }
+    hints->data = hints->lines + 2 * boardSize;
+
+    size_t offset = 0;
+    for (int i = 0; i < 2 * boardSize; i++) {
+        if (offset >= len || offset + 1 + clues[offset] > len) {
+            LOG_MESSAGE(MTNLOG_ERROR, "hints", "Clue data is truncated");
+            hintsDestroy(hints);
+            return false;
+        }
+        if (!_validLine(clues + offset + 1, clues[offset], boardSize)) {
+            LOG_MESSAGE(MTNLOG_ERROR, "hints", "Clues of line %d don't fit on the board", i);
+            hintsDestroy(hints);
             return false;
         }
+        hints->lines[i] = (int)offset;
+        offset += 1 + clues[offset];
     }
+    for (size_t i = 0; i < len; i++)
+        hints->data[i] = clues[i];
 
-    mtnlogMessageTag(MTNLOG_INFO, "hints", "Created hints for board of size %d", boardSize);
     return true;
 }
 
-void hintsDestroy(BoardHints *hints)
+size_t hintsDataSize(BoardHints *hints)
 {
-    if (hints->rows) {
-        for (int i = 0; i < hints->boardSize; ++i) {
-            free(hints->rows[i]);
-        }
-        free(hints->rows);
-        hints->rows = NULL;
+    int lastCount;
+    hintsGetCol(hints, hints->boardSize - 1, &lastCount);
+    return hints->lines[2 * hints->boardSize - 1] + 1 + lastCount;
+}
+
+bool hintsCreate(BoardHints *hints, Board *board)
+{
+    return _createFromPlanes(hints, board->solved, board->solvedCols, board->size, NULL);
+}
+
+bool hintsCreateArena(BoardHints *hints, Board *board, Arena *arena)
+{
+    return _createFromPlanes(hints, board->solved, board->solvedCols, board->size, arena);
+}
+
+// Whether the clues are the ones the board's solution gives, for clues that
+// were stored separately from it
+bool hintsMatchBoard(BoardHints *hints, Board *board)
+{
+    if (hints->boardSize != board->size)
+        return false;
+    int wpl = board->wordsPerLine;
+    int *runs = (int *)malloc(MAX_HINTS(board->size) * sizeof(int));
+    if (!runs) {
+        LOG_MESSAGE(MTNLOG_ERROR, "hints", "Failed to allocate %d runs", MAX_HINTS(board->size));
+        return false;
     }
 
-    if (hints->cols) {
-        for (int i = 0; i < hints->boardSize; ++i) {
-            free(hints->cols[i]);
-        }
-        free(hints->cols);
-        hints->cols = NULL;
+    bool match = true;
+    for (int i = 0; i < 2 * board->size && match; i++) {
+        const uint64_t *line = i < board->size ? board->solved + i * wpl : board->solvedCols + (i - board->size) * wpl;
+        const int *clues = hints->data + hints->lines[i];
+        int count = _extractRuns(line, wpl, runs);
+        match = count == clues[0] && memcmp(runs, clues + 1, count * sizeof(int)) == 0;
     }
+    free(runs);
+    return match;
+}
+
+void hintsDestroy(BoardHints *hints)
+{
+    // data lives in the same block as lines
+    if (!hints->arena)
+        free(hints->lines);
+    hints->lines = NULL;
+    hints->data = NULL;
+}
+
+const int *hintsGetRow(BoardHints *hints, int y, int *count)
+{
+    const int *line = hints->data + hints->lines[y];
+    *count = line[0];
+    return line + 1;
+}
+
+const int *hintsGetCol(BoardHints *hints, int x, int *count)
+{
+    const int *line = hints->data + hints->lines[hints->boardSize + x];
+    *count = line[0];
+    return line + 1;
 }
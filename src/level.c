@@ -0,0 +1,51 @@
+#include "level.h"
+#include "logger.h"
+#include <string.h>
+
+void levelInit(Level *level)
+{
+    memset(level, 0, sizeof(Level));
+    arenaInit(&level->arena);
+}
+
+void levelDestroy(Level *level)
+{
+    arenaDestroy(&level->arena);
+    memset(level, 0, sizeof(Level));
+}
+
+// Nothing the level handed out stays valid after this
+void levelUnload(Level *level)
+{
+    arenaReset(&level->arena);
+    memset(&level->board, 0, sizeof(Board));
+    memset(&level->meta, 0, sizeof(BoardMetadata));
+    memset(&level->hints, 0, sizeof(BoardHints));
+    level->loaded = false;
+}
+
+// Loading unloads whatever the level held before, also when it fails
+bool levelLoadFile(Level *level, const char *name, BoardLoadError *err)
+{
+    levelUnload(level);
+    level->loaded = boardLoadArena(&level->board, &level->meta, name, err, &level->arena)
+        && hintsCreateArena(&level->hints, &level->board, &level->arena);
+    if (!level->loaded) {
+        levelUnload(level);
+        return false;
+    }
+    LOG_MESSAGE(MTNLOG_INFO, "level", "Loaded '%s' into %zu bytes", name, arenaUsed(&level->arena));
+    return true;
+}
+
+bool levelLoadPack(Level *level, Pack *pack, int index)
+{
+    levelUnload(level);
+    level->loaded = packLoadLevelArena(pack, index, &level->board, &level->meta, &level->hints, &level->arena);
+    if (!level->loaded) {
+        levelUnload(level);
+        return false;
+    }
+    LOG_MESSAGE(MTNLOG_INFO, "level", "Loaded level %d of a pack into %zu bytes", index, arenaUsed(&level->arena));
+    return true;
+}
@@ -0,0 +1,457 @@
+#include "levellist.h"
+#include "logger.h"
+#include "profiler.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define LABEL_SCALE 0.75f
+
+static const char *_nameOf(CatalogEntry *entry)
+{
+    return entry && entry->name ? entry->name : "";
+}
+
+static const char *_authorOf(CatalogEntry *entry)
+{
+    return entry && entry->author ? entry->author : "";
+}
+
+static int _compareFile(const void *a, const void *b)
+{
+    return ((const LevelListItem *)a)->index - ((const LevelListItem *)b)->index;
+}
+
+// Items without metadata yet sort after the others, in file order
+static bool _orderUnloaded(const LevelListItem *a, const LevelListItem *b, int *order)
+{
+    if (a->entry && b->entry)
+        return false;
+    *order = a->entry ? -1 : b->entry ? 1 : a->index - b->index;
+    return true;
+}
+
+static int _compareName(const void *a, const void *b)
+{
+    const LevelListItem *ia = (const LevelListItem *)a;
+    const LevelListItem *ib = (const LevelListItem *)b;
+    int c;
+    if (_orderUnloaded(ia, ib, &c))
+        return c;
+    c = strcasecmp(_nameOf(ia->entry), _nameOf(ib->entry));
+    return c != 0 ? c : ia->index - ib->index;
+}
+
+static int _compareAuthor(const void *a, const void *b)
+{
+    const LevelListItem *ia = (const LevelListItem *)a;
+    const LevelListItem *ib = (const LevelListItem *)b;
+    int c;
+    if (_orderUnloaded(ia, ib, &c))
+        return c;
+    c = strcasecmp(_authorOf(ia->entry), _authorOf(ib->entry));
+    return c != 0 ? c : _compareName(a, b);
+}
+
+static int _compareSize(const void *a, const void *b)
+{
+    const LevelListItem *ia = (const LevelListItem *)a;
+    const LevelListItem *ib = (const LevelListItem *)b;
+    int c;
+    if (_orderUnloaded(ia, ib, &c))
+        return c;
+    c = ia->entry->boardSize - ib->entry->boardSize;
+    return c != 0 ? c : _compareName(a, b);
+}
+
+static bool _containsNoCase(const char *haystack, const char *needle)
+{
+    size_t len = strlen(needle);
+    if (len == 0)
+        return true;
+    for (; *haystack; haystack++) {
+        if (strncasecmp(haystack, needle, len) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Levels whose metadata isn't loaded yet can't match a filter
+static bool _matches(LevelList *list, LevelListItem *item)
+{
+    if (list->filter[0] == '\0')
+        return true;
+    if (!item->entry)
+        return false;
+    return _containsNoCase(_nameOf(item->entry), list->filter) || _containsNoCase(_authorOf(item->entry), list->filter);
+}
+
+static void _clampScroll(LevelList *list)
+{
+    int maxFirst = list->numShown - list->numRows;
+    if (list->first > maxFirst)
+        list->first = maxFirst;
+    if (list->first < 0)
+        list->first = 0;
+}
+
+static void _scrollToSelected(LevelList *list)
+{
+    if (list->selected < list->first)
+        list->first = list->selected;
+    else if (list->selected >= list->first + list->numRows)
+        list->first = list->selected - list->numRows + 1;
+    _clampScroll(list);
+}
+
+// Selects the catalog level index again after the shown rows changed, or the
+// first row when it's gone
+static void _reselect(LevelList *list, int index)
+{
+    list->selected = 0;
+    for (int i = 0; i < list->numShown; i++) {
+        if (list->items[list->shown[i]].index == index) {
+            list->selected = i;
+            break;
+        }
+    }
+    _scrollToSelected(list);
+}
+
+static void _refilter(LevelList *list)
+{
+    int numItems = catalogGetNumEntries(list->catalog);
+    list->numShown = 0;
+    for (int i = 0; i < numItems; i++) {
+        if (_matches(list, &list->items[i]))
+            list->shown[list->numShown++] = i;
+    }
+}
+
+static void _sort(LevelList *list)
+{
+    int (*compare)(const void *, const void *) = _compareFile;
+    switch (list->sort) {
+    case LevelSort_File:
+        compare = _compareFile;
+        break;
+    case LevelSort_Name:
+        compare = _compareName;
+        break;
+    case LevelSort_Author:
+        compare = _compareAuthor;
+        break;
+    case LevelSort_Size:
+        compare = _compareSize;
+        break;
+    }
+    qsort(list->items, catalogGetNumEntries(list->catalog), sizeof(LevelListItem), compare);
+    // sorting by metadata puts every item that has it first
+    list->metaCursor = list->sort == LevelSort_File ? 0 : list->numMetaLoaded;
+}
+
+bool levelListInit(LevelList *list, Catalog *catalog)
+{
+    memset(list, 0, sizeof(LevelList));
+    list->catalog = catalog;
+    list->numRows = 1;
+    for (int i = 0; i < LEVEL_LIST_CACHE_SIZE; i++)
+        list->labels[i].index = -1;
+
+    int numItems = catalogGetNumEntries(catalog);
+    list->items = (LevelListItem *)malloc((numItems ? numItems : 1) * sizeof(LevelListItem));
+    list->shown = (int *)malloc((numItems ? numItems : 1) * sizeof(int));
+    if (!list->items || !list->shown) {
+        LOG_MESSAGE(MTNLOG_ERROR, "levellist", "Failed to allocate level list");
+        levelListDestroy(list);
+        return false;
+    }
+    // whatever the catalog cache knew is there from the start
+    for (int i = 0; i < numItems; i++) {
+        list->items[i].entry = catalog->entries[i].metaLoaded ? &catalog->entries[i] : NULL;
+        list->items[i].index = i;
+        list->numMetaLoaded += list->items[i].entry != NULL;
+    }
+    _refilter(list);
+    return true;
+}
+
+void levelListDestroy(LevelList *list)
+{
+    levelListInvalidate(list);
+    free(list->items);
+    free(list->shown);
+    list->items = NULL;
+    list->shown = NULL;
+    list->numShown = 0;
+}
+
+// Drops every cached label, e.g. after the renderer lost its textures
+void levelListInvalidate(LevelList *list)
+{
+    for (int i = 0; i < LEVEL_LIST_CACHE_SIZE; i++) {
+        if (list->labels[i].texture)
+            SDL_DestroyTexture(list->labels[i].texture);
+        list->labels[i].texture = NULL;
+        list->labels[i].index = -1;
+        list->labels[i].lastUsed = 0;
+    }
+}
+
+void levelListSetNumRows(LevelList *list, int numRows)
+{
+    list->numRows = numRows > 1 ? numRows : 1;
+    _scrollToSelected(list);
+}
+
+// Returns whether the selection moved
+bool levelListSelect(LevelList *list, int selected)
+{
+    if (selected >= list->numShown)
+        selected = list->numShown - 1;
+    if (selected < 0)
+        selected = 0;
+    if (selected == list->selected)
+        return false;
+    list->selected = selected;
+    _scrollToSelected(list);
+    return true;
+}
+
+// Returns whether the view moved
+bool levelListScroll(LevelList *list, int rows)
+{
+    int oldFirst = list->first;
+    list->first += rows;
+    _clampScroll(list);
+    return list->first != oldFirst;
+}
+
+// Catalog index of the level shown in a row, or -1 for rows past either end
+int levelListGetLevel(LevelList *list, int row)
+{
+    if (row < 0 || row >= list->numShown)
+        return -1;
+    return list->items[list->shown[row]].index;
+}
+
+// Catalog index of the selected level, or -1 when nothing is shown
+int levelListGetSelectedLevel(LevelList *list)
+{
+    return levelListGetLevel(list, list->selected);
+}
+
+// Whether sorting or filtering is waiting for metadata levelListLoadMeta
+// hasn't loaded yet
+bool levelListNeedsMeta(LevelList *list)
+{
+    if (list->numMetaLoaded == catalogGetNumEntries(list->catalog))
+        return false;
+    return list->sort != LevelSort_File || list->filter[0] != '\0';
+}
+
+// Parses metadata for about budgetMs, which can mean reading every plain level
+// file the catalog cache doesn't know, then sorts and filters again with it.
+// Returns whether the shown rows may have changed.
+bool levelListLoadMeta(LevelList *list, double budgetMs)
+{
+    if (!levelListNeedsMeta(list))
+        return false;
+    uint64_t start = monotonicNs();
+    uint64_t budgetNs = (uint64_t)(budgetMs * 1e6);
+    int numItems = catalogGetNumEntries(list->catalog);
+    int loaded = 0;
+    // at least one entry per call, however small the budget
+    while (list->metaCursor < numItems && (loaded == 0 || monotonicNs() - start < budgetNs)) {
+        LevelListItem *item = &list->items[list->metaCursor++];
+        if (item->entry)
+            continue;
+        item->entry = catalogGetEntry(list->catalog, item->index);
+        list->numMetaLoaded++;
+        loaded++;
+    }
+    if (loaded == 0)
+        return false;
+
+    int selected = levelListGetSelectedLevel(list);
+    if (list->sort != LevelSort_File)
+        _sort(list);
+    _refilter(list);
+    _reselect(list, selected);
+    if (list->numMetaLoaded == numItems)
+        LOG_MESSAGE(MTNLOG_INFO, "levellist", "Loaded metadata for all %d levels", numItems);
+    return true;
+}
+
+void levelListSetSort(LevelList *list, LevelSort sort)
+{
+    if (sort == list->sort)
+        return;
+    int selected = levelListGetSelectedLevel(list);
+    list->sort = sort;
+    _sort(list);
+    _refilter(list);
+    _reselect(list, selected);
+}
+
+// A longer filter can only match fewer levels, so only the shown ones get
+// looked at again
+void levelListAppendFilter(LevelList *list, const char *text)
+{
+    size_t len = strlen(list->filter);
+    size_t textLen = strlen(text);
+    if (textLen == 0 || len + textLen >= LEVEL_LIST_FILTER_SIZE)
+        return;
+    int selected = levelListGetSelectedLevel(list);
+    memcpy(list->filter + len, text, textLen + 1);
+
+    int numShown = 0;
+    for (int i = 0; i < list->numShown; i++) {
+        if (_matches(list, &list->items[list->shown[i]]))
+            list->shown[numShown++] = list->shown[i];
+    }
+    list->numShown = numShown;
+    _reselect(list, selected);
+}
+
+// Removes the last character of the filter, returns false if it was empty
+bool levelListBackspace(LevelList *list)
+{
+    size_t len = strlen(list->filter);
+    if (len == 0)
+        return false;
+    // step back over UTF-8 continuation bytes
+    len--;
+    while (len > 0 && ((unsigned char)list->filter[len] & 0xC0) == 0x80)
+        len--;
+    list->filter[len] = '\0';
+
+    int selected = levelListGetSelectedLevel(list);
+    _refilter(list);
+    _reselect(list, selected);
+    return true;
+}
+
+const char *levelListSortString(LevelSort sort)
+{
+    switch (sort) {
+    case LevelSort_File:
+        return "file";
+    case LevelSort_Name:
+        return "name";
+    case LevelSort_Author:
+        return "author";
+    case LevelSort_Size:
+        return "size";
+    }
+    return "?";
+}
+
+static LevelLabel *_findLabel(LevelList *list, int index)
+{
+    for (int i = 0; i < LEVEL_LIST_CACHE_SIZE; i++) {
+        if (list->labels[i].index == index)
+            return &list->labels[i];
+    }
+    return NULL;
+}
+
+static void _formatLabel(LevelList *list, int index, char *buf, size_t size)
+{
+    CatalogEntry *entry = catalogGetEntry(list->catalog, index);
+    snprintf(buf, size, "%s by %s (%dx%d)", _nameOf(entry), _authorOf(entry), entry->boardSize, entry->boardSize);
+}
+
+// Renders the label into a texture once, in white so the selection color can
+// be applied with a color mod
+static void _renderLabel(LevelList *list, SDL_Renderer *rend, FC_Font *font, LevelLabel *label, int index)
+{
+    char text[256];
+    _formatLabel(list, index, text, sizeof(text));
+
+    if (label->texture)
+        SDL_DestroyTexture(label->texture);
+    label->index = index;
+    label->w = (int)(FC_GetWidth(font, "%s", text) * LABEL_SCALE) + 2;
+    label->h = (int)(FC_GetLineHeight(font) * LABEL_SCALE) + 2;
+    label->texture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, label->w, label->h);
+    if (!label->texture)
+        return; // gets drawn directly instead
+    PROFILE_ALLOC((size_t)label->w * label->h * 4);
+
+    SDL_Texture *oldTarget = SDL_GetRenderTarget(rend);
+    SDL_SetTextureBlendMode(label->texture, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderTarget(rend, label->texture);
+    SDL_SetRenderDrawColor(rend, 0, 0, 0, 0);
+    SDL_RenderClear(rend);
+    FC_DrawEffect(font, rend, 0, 0, FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(LABEL_SCALE, LABEL_SCALE), FC_MakeColor(255, 255, 255, 255)), "%s", text);
+    SDL_SetRenderTarget(rend, oldTarget);
+}
+
+// Makes sure every row on screen has a label texture. Has to be called
+// outside of any render target and clip rect, since it switches targets.
+void levelListPrepare(LevelList *list, SDL_Renderer *rend, FC_Font *font)
+{
+    uint64_t frame = ++list->useCounter;
+    int last = list->first + list->numRows;
+    if (last > list->numShown)
+        last = list->numShown;
+
+    for (int row = list->first; row < last; row++) {
+        int index = list->items[list->shown[row]].index;
+        LevelLabel *label = _findLabel(list, index);
+        if (!label) {
+            // take the least recently used slot, but never one that's on
+            // screen this frame
+            for (int i = 0; i < LEVEL_LIST_CACHE_SIZE; i++) {
+                LevelLabel *slot = &list->labels[i];
+                if (slot->lastUsed != frame && (!label || slot->lastUsed < label->lastUsed))
+                    label = slot;
+            }
+            if (!label)
+                continue;
+            _renderLabel(list, rend, font, label, index);
+        }
+        label->lastUsed = frame;
+    }
+}
+
+// Only the rows that reach into the clip rect get drawn
+void levelListDraw(LevelList *list, SDL_Renderer *rend, FC_Font *font, int x, int y)
+{
+    int first = list->first;
+    int last = list->first + list->numRows;
+    if (last > list->numShown)
+        last = list->numShown;
+    if (SDL_RenderIsClipEnabled(rend)) {
+        SDL_Rect clip;
+        SDL_RenderGetClipRect(rend, &clip);
+        if (clip.x + clip.w <= x)
+            return;
+        int top = list->first + (clip.y - y) / LEVEL_LIST_ROW_HEIGHT;
+        int bottom = list->first + (clip.y + clip.h - y + LEVEL_LIST_ROW_HEIGHT - 1) / LEVEL_LIST_ROW_HEIGHT;
+        if (clip.y > y && top > first)
+            first = top;
+        if (bottom < last)
+            last = bottom;
+    }
+
+    for (int row = first; row < last; row++) {
+        int index = list->items[list->shown[row]].index;
+        int rowY = y + (row - list->first) * LEVEL_LIST_ROW_HEIGHT;
+        SDL_Color color = row == list->selected ? FC_MakeColor(0, 255, 0, 255) : FC_MakeColor(255, 255, 255, 255);
+        LevelLabel *label = _findLabel(list, index);
+
+        if (label && label->texture) {
+            SDL_Rect dst = {x, rowY, label->w, label->h};
+            SDL_SetTextureColorMod(label->texture, color.r, color.g, color.b);
+            SDL_RenderCopy(rend, label->texture, NULL, &dst);
+        } else {
+            char text[256];
+            _formatLabel(list, index, text, sizeof(text));
+            FC_DrawEffect(font, rend, x, rowY, FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(LABEL_SCALE, LABEL_SCALE), color), "%s", text);
+        }
+    }
+}
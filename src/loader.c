@@ -0,0 +1,248 @@
+#include "loader.h"
+#include "logger.h"
+#include "profiler.h"
+#include "util.h"
+#include <string.h>
+
+static int _findSlot(Loader *loader, int index)
+{
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++) {
+        if (loader->slots[i].index == index)
+            return i;
+    }
+    return -1;
+}
+
+static void _touch(Loader *loader, int slot)
+{
+    loader->slots[slot].lastUsed = ++loader->useCounter;
+}
+
+static void _dequeue(Loader *loader, int slot)
+{
+    for (int i = 0; i < loader->queueLen; i++) {
+        if (loader->queue[i] == slot) {
+            memmove(loader->queue + i, loader->queue + i + 1, (loader->queueLen - i - 1) * sizeof(int));
+            loader->queueLen--;
+            return;
+        }
+    }
+}
+
+static void _enqueue(Loader *loader, int slot, bool first)
+{
+    _dequeue(loader, slot);
+    if (first) {
+        memmove(loader->queue + 1, loader->queue, loader->queueLen * sizeof(int));
+        loader->queue[0] = slot;
+    } else {
+        loader->queue[loader->queueLen] = slot;
+    }
+    loader->queueLen++;
+    loader->slots[slot].state = LoaderSlot_Queued;
+}
+
+// A free slot, or the least recently used one that isn't being loaded, played
+// or waited for, whatever state the waited for level is in. Returns -1 if
+// there is none.
+static int _claimSlot(Loader *loader, int index)
+{
+    int victim = -1;
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++) {
+        LoaderSlot *slot = &loader->slots[i];
+        if (slot->state == LoaderSlot_Free) {
+            victim = i;
+            break;
+        }
+        if (slot->pinned || slot->requested || slot->state == LoaderSlot_Loading)
+            continue;
+        if (victim < 0 || slot->lastUsed < loader->slots[victim].lastUsed)
+            victim = i;
+    }
+    if (victim < 0)
+        return -1;
+
+    _dequeue(loader, victim);
+    loader->slots[victim].index = index;
+    loader->slots[victim].state = LoaderSlot_Free;
+    loader->slots[victim].requested = false;
+    _touch(loader, victim);
+    return victim;
+}
+
+static void *_work(void *arg)
+{
+    Loader *loader = (Loader *)arg;
+    pthread_mutex_lock(&loader->lock);
+    while (loader->running) {
+        if (loader->queueLen == 0) {
+            pthread_cond_wait(&loader->wake, &loader->lock);
+            continue;
+        }
+
+        int s = loader->queue[0];
+        LoaderSlot *slot = &loader->slots[s];
+        _dequeue(loader, s);
+        slot->state = LoaderSlot_Loading;
+        int index = slot->index;
+        pthread_mutex_unlock(&loader->lock);
+
+        // the worker records into its own ring, so traces show loads as a thread of their own
+        uint64_t start = monotonicNs();
+        PROFILE_BEGIN(scope, "load level");
+        bool ok = catalogLoadLevel(loader->catalog, index, &slot->level);
+        PROFILE_END(scope);
+        double ms = (monotonicNs() - start) / 1e6;
+
+        pthread_mutex_lock(&loader->lock);
+        slot->state = ok ? LoaderSlot_Ready : LoaderSlot_Failed;
+        slot->loadMs = ms;
+        pthread_mutex_unlock(&loader->lock);
+        if (!ok)
+            LOG_MESSAGE(MTNLOG_ERROR, "loader", "Failed to load level %d", index);
+        if (loader->onLoaded)
+            loader->onLoaded(loader->arg, index);
+        pthread_mutex_lock(&loader->lock);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+bool loaderStart(Loader *loader, Catalog *catalog, void (*onLoaded)(void *arg, int index), void *arg)
+{
+    memset(loader, 0, sizeof(Loader));
+    loader->catalog = catalog;
+    loader->onLoaded = onLoaded;
+    loader->arg = arg;
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++) {
+        levelInit(&loader->slots[i].level);
+        loader->slots[i].index = -1;
+    }
+
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+    loader->running = true;
+    if (pthread_create(&loader->thread, NULL, _work, loader) != 0) {
+        LOG_MESSAGE(MTNLOG_ERROR, "loader", "Failed to start the loader thread");
+        loader->running = false;
+        pthread_cond_destroy(&loader->wake);
+        pthread_mutex_destroy(&loader->lock);
+        return false;
+    }
+    return true;
+}
+
+// Waits for the level being loaded, if any, and frees every level
+void loaderStop(Loader *loader)
+{
+    if (!loader->running)
+        return;
+    pthread_mutex_lock(&loader->lock);
+    loader->running = false;
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+    pthread_join(loader->thread, NULL);
+
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++)
+        levelDestroy(&loader->slots[i].level);
+    pthread_cond_destroy(&loader->wake);
+    pthread_mutex_destroy(&loader->lock);
+}
+
+// Puts the level at the front of the queue unless it's already there or
+// loaded. Levels that failed to load are tried again. The level stays put
+// until loaderAcquire hands it out, only the latest request is waited for.
+void loaderRequest(Loader *loader, int index)
+{
+    pthread_mutex_lock(&loader->lock);
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++)
+        loader->slots[i].requested = false;
+    int s = _findSlot(loader, index);
+    if (s >= 0) {
+        _touch(loader, s);
+    } else {
+        s = _claimSlot(loader, index);
+        if (s < 0) {
+            pthread_mutex_unlock(&loader->lock);
+            LOG_MESSAGE(MTNLOG_WARNING, "loader", "No free slot for level %d", index);
+            return;
+        }
+    }
+
+    loader->slots[s].requested = true;
+    LoaderSlotState state = loader->slots[s].state;
+    if (state == LoaderSlot_Free || state == LoaderSlot_Queued || state == LoaderSlot_Failed) {
+        _enqueue(loader, s, true);
+        pthread_cond_signal(&loader->wake);
+    }
+    pthread_mutex_unlock(&loader->lock);
+}
+
+// indices are in order of importance, levels already loaded only count as
+// used. Prefetches from earlier calls that haven't started are dropped.
+void loaderPrefetch(Loader *loader, const int *indices, int count)
+{
+    pthread_mutex_lock(&loader->lock);
+    int queueLen = 0;
+    for (int i = 0; i < loader->queueLen; i++) {
+        LoaderSlot *slot = &loader->slots[loader->queue[i]];
+        if (slot->requested) {
+            loader->queue[queueLen++] = loader->queue[i];
+        } else {
+            slot->state = LoaderSlot_Free;
+            slot->index = -1;
+            slot->lastUsed = 0;
+        }
+    }
+    loader->queueLen = queueLen;
+
+    for (int i = 0; i < count; i++) {
+        if (indices[i] < 0)
+            continue;
+        int s = _findSlot(loader, indices[i]);
+        if (s >= 0) {
+            _touch(loader, s);
+            continue;
+        }
+        s = _claimSlot(loader, indices[i]);
+        if (s < 0)
+            break;
+        _enqueue(loader, s, false);
+    }
+    if (loader->queueLen > 0)
+        pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+// Returns the level if it's loaded and keeps it from being evicted until
+// loaderRelease. Otherwise returns NULL and sets failed if loading it failed.
+Level *loaderAcquire(Loader *loader, int index, bool *failed, double *loadMs)
+{
+    Level *level = NULL;
+    *failed = false;
+    pthread_mutex_lock(&loader->lock);
+    int s = _findSlot(loader, index);
+    if (s >= 0 && loader->slots[s].state == LoaderSlot_Ready) {
+        LoaderSlot *slot = &loader->slots[s];
+        slot->pinned = true;
+        slot->requested = false;
+        _touch(loader, s);
+        *loadMs = slot->loadMs;
+        level = &slot->level;
+    } else if (s >= 0 && loader->slots[s].state == LoaderSlot_Failed) {
+        loader->slots[s].requested = false;
+        *failed = true;
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return level;
+}
+
+void loaderRelease(Loader *loader, Level *level)
+{
+    pthread_mutex_lock(&loader->lock);
+    for (int i = 0; i < LOADER_CACHE_SIZE; i++) {
+        if (&loader->slots[i].level == level)
+            loader->slots[i].pinned = false;
+    }
+    pthread_mutex_unlock(&loader->lock);
+}
@@ -0,0 +1,449 @@
+#include "logger.h"
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+
+#define LOGGER_LINE_SIZE 512
+
+typedef enum e_logger_arg {
+    LoggerArg_None,
+    LoggerArg_Int,
+    LoggerArg_Long,
+    LoggerArg_LongLong,
+    LoggerArg_Size,
+    LoggerArg_IntMax,
+    LoggerArg_PtrDiff,
+    LoggerArg_Double,
+    LoggerArg_LongDouble,
+    LoggerArg_String,
+    LoggerArg_Pointer,
+    LoggerArg_Percent
+} LoggerArg;
+
+// One queued message. seq says whose turn the slot is: producers may fill it
+// when seq equals their ticket, the flusher may read it when seq is ticket + 1.
+typedef struct s_logger_slot {
+    atomic_size_t seq;
+    int level;
+    const char *tag;
+    const char *fmt;
+    size_t argSize;
+    unsigned char args[LOGGER_ARG_BYTES];
+} LoggerSlot;
+
+static LoggerSlot _slots[LOGGER_QUEUE_SIZE];
+static atomic_size_t _tail;
+static size_t _head; // only touched by the flusher
+static atomic_bool _running;
+static atomic_int _writers; // loggerWrite calls that may still use the queue
+static atomic_long _dropped;
+static int _minLevel = MTNLOG_INFO;
+static pthread_t _thread;
+static sem_t _wake;
+
+// Parses the conversion after a '%' and returns where it ends. stars is the
+// number of '*' widths and precisions, which come as extra int arguments.
+static const char *_parseSpec(const char *p, LoggerArg *arg, int *stars)
+{
+    *stars = 0;
+    while (*p && strchr("-+ #0'", *p))
+        p++;
+    if (*p == '*') {
+        (*stars)++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9')
+        p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            (*stars)++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+
+    int longs = 0;
+    char size = 0;
+    for (; *p && strchr("hlzjtL", *p); p++) {
+        if (*p == 'l')
+            longs++;
+        else if (*p != 'h')
+            size = *p;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        if (size == 'z')
+            *arg = LoggerArg_Size;
+        else if (size == 'j')
+            *arg = LoggerArg_IntMax;
+        else if (size == 't')
+            *arg = LoggerArg_PtrDiff;
+        else
+            *arg = longs >= 2 ? LoggerArg_LongLong : longs == 1 ? LoggerArg_Long : LoggerArg_Int;
+        break;
+    case 'c':
+        *arg = LoggerArg_Int;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        *arg = size == 'L' ? LoggerArg_LongDouble : LoggerArg_Double;
+        break;
+    case 's':
+        *arg = LoggerArg_String;
+        break;
+    case 'p':
+        *arg = LoggerArg_Pointer;
+        break;
+    case '%':
+        *arg = LoggerArg_Percent;
+        break;
+    default:
+        *arg = LoggerArg_None;
+        return *p ? p + 1 : p;
+    }
+    return p + 1;
+}
+
+static bool _put(LoggerSlot *slot, const void *value, size_t size)
+{
+    if (slot->argSize + size > LOGGER_ARG_BYTES)
+        return false;
+    memcpy(slot->args + slot->argSize, value, size);
+    slot->argSize += size;
+    return true;
+}
+
+#define PUT_ARG(slot, type, ap) \
+    do { \
+        type v_ = va_arg(ap, type); \
+        ok = _put(slot, &v_, sizeof(v_)); \
+    } while (0)
+
+// Copies the arguments as raw values in format order. Once they don't fit
+// anymore the rest of the message gets cut off.
+static void _captureArgs(LoggerSlot *slot, const char *fmt, va_list ap)
+{
+    bool ok = true;
+    slot->argSize = 0;
+    for (const char *p = strchr(fmt, '%'); p && ok; p = strchr(p, '%')) {
+        LoggerArg arg;
+        int stars;
+        p = _parseSpec(p + 1, &arg, &stars);
+        for (int i = 0; i < stars && ok; i++)
+            PUT_ARG(slot, int, ap);
+        if (!ok)
+            break;
+
+        switch (arg) {
+        case LoggerArg_Int:
+            PUT_ARG(slot, int, ap);
+            break;
+        case LoggerArg_Long:
+            PUT_ARG(slot, long, ap);
+            break;
+        case LoggerArg_LongLong:
+            PUT_ARG(slot, long long, ap);
+            break;
+        case LoggerArg_Size:
+            PUT_ARG(slot, size_t, ap);
+            break;
+        case LoggerArg_IntMax:
+            PUT_ARG(slot, intmax_t, ap);
+            break;
+        case LoggerArg_PtrDiff:
+            PUT_ARG(slot, ptrdiff_t, ap);
+            break;
+        case LoggerArg_Double:
+            PUT_ARG(slot, double, ap);
+            break;
+        case LoggerArg_LongDouble:
+            PUT_ARG(slot, long double, ap);
+            break;
+        case LoggerArg_Pointer:
+            PUT_ARG(slot, void *, ap);
+            break;
+        case LoggerArg_String: {
+            const char *str = va_arg(ap, const char *);
+            if (!str)
+                str = "(null)";
+            size_t len = strlen(str) + 1;
+            size_t room = LOGGER_ARG_BYTES - slot->argSize;
+            if (len > room) {
+                // keep what fits, the flusher stops after it
+                memcpy(slot->args + slot->argSize, str, room);
+                slot->args[LOGGER_ARG_BYTES - 1] = '\0';
+                slot->argSize = LOGGER_ARG_BYTES;
+                ok = false;
+            } else {
+                ok = _put(slot, str, len);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+#define GET_ARG(type) \
+    type v_; \
+    if (pos + sizeof(type) > slot->argSize) \
+        goto truncated; \
+    memcpy(&v_, slot->args + pos, sizeof(type)); \
+    pos += sizeof(type)
+
+// Formats a captured message, one conversion at a time with its own spec
+static void _formatSlot(LoggerSlot *slot, char *out, size_t outSize)
+{
+    size_t len = 0;
+    size_t pos = 0;
+    const char *p = slot->fmt;
+    out[0] = '\0';
+
+    while (*p && len < outSize - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        LoggerArg arg;
+        int stars;
+        const char *end = _parseSpec(p + 1, &arg, &stars);
+
+        // rebuild the spec with the '*' values filled in
+        char spec[64];
+        size_t specLen = 0;
+        for (const char *s = p; s < end && specLen < sizeof(spec) - 12; s++) {
+            if (*s == '*') {
+                GET_ARG(int);
+                specLen += snprintf(spec + specLen, sizeof(spec) - specLen, "%d", v_);
+            } else {
+                spec[specLen++] = *s;
+            }
+        }
+        spec[specLen] = '\0';
+        p = end;
+
+        size_t room = outSize - len;
+        int n = 0;
+        switch (arg) {
+        case LoggerArg_Int: {
+            GET_ARG(int);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_Long: {
+            GET_ARG(long);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_LongLong: {
+            GET_ARG(long long);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_Size: {
+            GET_ARG(size_t);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_IntMax: {
+            GET_ARG(intmax_t);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_PtrDiff: {
+            GET_ARG(ptrdiff_t);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_Double: {
+            GET_ARG(double);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_LongDouble: {
+            GET_ARG(long double);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_Pointer: {
+            GET_ARG(void *);
+            n = snprintf(out + len, room, spec, v_);
+            break;
+        }
+        case LoggerArg_String: {
+            if (pos >= slot->argSize)
+                goto truncated;
+            const char *str = (const char *)slot->args + pos;
+            pos += strlen(str) + 1;
+            n = snprintf(out + len, room, spec, str);
+            break;
+        }
+        case LoggerArg_Percent:
+            n = snprintf(out + len, room, "%%");
+            break;
+        default:
+            break;
+        }
+        if (n > 0)
+            len += (size_t)n < room ? (size_t)n : room - 1;
+    }
+    out[len] = '\0';
+    return;
+
+truncated:
+    snprintf(out + len, outSize - len, "...");
+}
+
+static void _emit(int level, const char *tag, const char *line)
+{
+    if (tag)
+        mtnlogMessageTag(level, tag, "%s", line);
+    else
+        mtnlogMessage(level, "%s", line);
+}
+
+// Hands every queued message to mtnlog. Only the flusher thread calls this
+// while the logger runs.
+static void _drain(void)
+{
+    char line[LOGGER_LINE_SIZE];
+    while (true) {
+        LoggerSlot *slot = &_slots[_head & (LOGGER_QUEUE_SIZE - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != _head + 1)
+            break;
+        _formatSlot(slot, line, sizeof(line));
+        int level = slot->level;
+        const char *tag = slot->tag;
+        atomic_store_explicit(&slot->seq, _head + LOGGER_QUEUE_SIZE, memory_order_release);
+        _head++;
+        _emit(level, tag, line);
+    }
+
+    long dropped = atomic_exchange(&_dropped, 0);
+    if (dropped > 0)
+        mtnlogMessageTag(MTNLOG_WARNING, "log", "Log queue was full, dropped %ld messages", dropped);
+}
+
+static void *_flusherTask(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&_running)) {
+        sem_wait(&_wake);
+        _drain();
+    }
+    return NULL;
+}
+
+bool loggerStart(int minLevel)
+{
+    if (atomic_load(&_running))
+        return true;
+
+    for (size_t i = 0; i < LOGGER_QUEUE_SIZE; i++)
+        atomic_store(&_slots[i].seq, i);
+    atomic_store(&_tail, 0);
+    _head = 0;
+    _minLevel = minLevel;
+
+    if (sem_init(&_wake, 0, 0) != 0) {
+        mtnlogMessageTag(MTNLOG_WARNING, "log", "Failed to create log semaphore, logging synchronously");
+        return false;
+    }
+    atomic_store(&_running, true);
+    int code = pthread_create(&_thread, NULL, _flusherTask, NULL);
+    if (code != 0) {
+        atomic_store(&_running, false);
+        sem_destroy(&_wake);
+        mtnlogMessageTag(MTNLOG_WARNING, "log", "Failed to create log thread (error %d), logging synchronously", code);
+        return false;
+    }
+    return true;
+}
+
+// Flushes everything still queued. Messages logged after this are written
+// synchronously again. Writers that saw the logger running get to finish
+// first, so their messages make the last drain and the semaphore outlives
+// their sem_post.
+void loggerStop(void)
+{
+    if (!atomic_load(&_running))
+        return;
+    atomic_store(&_running, false);
+    while (atomic_load(&_writers) > 0)
+        sched_yield();
+    sem_post(&_wake);
+    pthread_join(_thread, NULL);
+    _drain();
+    sem_destroy(&_wake);
+}
+
+void loggerWrite(int level, const char *tag, const char *fmt, ...)
+{
+    if (level < _minLevel)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    // counted before checking _running, so loggerStop either sees this writer
+    // or this writer sees it stopped
+    atomic_fetch_add(&_writers, 1);
+    if (!atomic_load(&_running)) {
+        atomic_fetch_sub(&_writers, 1);
+        char line[LOGGER_LINE_SIZE];
+        vsnprintf(line, sizeof(line), fmt, ap);
+        va_end(ap);
+        _emit(level, tag, line);
+        return;
+    }
+
+    // claim a ticket, or give up if the slot it maps to is still unread
+    size_t pos = atomic_load_explicit(&_tail, memory_order_relaxed);
+    LoggerSlot *slot;
+    while (true) {
+        slot = &_slots[pos & (LOGGER_QUEUE_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&_tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add(&_dropped, 1);
+            atomic_fetch_sub(&_writers, 1);
+            va_end(ap);
+            return;
+        } else {
+            pos = atomic_load_explicit(&_tail, memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->tag = tag;
+    slot->fmt = fmt;
+    _captureArgs(slot, fmt, ap);
+    va_end(ap);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    sem_post(&_wake);
+    atomic_fetch_sub(&_writers, 1);
+}
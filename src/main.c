@@ -1,7 +1,26 @@
 #include "game.h"
+#include "args.h"
+#include "batch.h"
+#include "logger.h"
 
 int main(int argc, char **argv)
 {
-    gameRun(argc, argv);
+    ArgParseResult res = argsParse(argc, argv);
+    if (res == ArgParseResult_HelpCommand)
+        return 0;
+    if (res != ArgParseResult_OK)
+        return 1;
+
+    if (argsGetBatchMode() != BatchMode_None) {
+        // headless, SDL never gets initialized
+        mtnlogInit(MTNLOG_ERROR, "pikurosu.log");
+        loggerStart(MTNLOG_ERROR);
+        int code = batchRun(argsGetBatchMode(), argsGetBatchSource(), argsGetBatchOutput(), argsGetThreads());
+        loggerStop();
+        argsCleanup();
+        return code;
+    }
+
+    gameRun();
     return 0;
 }
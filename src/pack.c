@@ -0,0 +1,300 @@
+#include "pack.h"
+#include "util.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+_Static_assert(sizeof(PackHeader) == 32, "PackHeader layout changed");
+_Static_assert(sizeof(PackEntry) == 40, "PackEntry layout changed");
+
+bool packOpenBuffer(Pack *pack, const char *buf, size_t len)
+{
+    memset(pack, 0, sizeof(Pack));
+    if (len < sizeof(PackHeader)) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Pack is too small");
+        return false;
+    }
+
+    const PackHeader *header = (const PackHeader *)buf;
+    if (memcmp(header->magic, PACK_MAGIC, 4) != 0 || header->version != PACK_VERSION) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Not a version %d level pack", PACK_VERSION);
+        return false;
+    }
+
+    size_t entriesEnd = sizeof(PackHeader) + (size_t)header->numLevels * sizeof(PackEntry);
+    if (entriesEnd > len || header->stringsOffset < entriesEnd || header->stringsOffset > len || header->stringsSize > len - header->stringsOffset) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Pack index is truncated");
+        return false;
+    }
+    if (header->stringsSize > 0 && buf[header->stringsOffset + header->stringsSize - 1] != '\0') {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Pack string table is not terminated");
+        return false;
+    }
+
+    pack->data = buf;
+    pack->len = len;
+    pack->header = header;
+    pack->entries = (const PackEntry *)(buf + sizeof(PackHeader));
+    pack->strings = buf + header->stringsOffset;
+    return true;
+}
+
+bool packOpen(Pack *pack, const char *name)
+{
+    size_t len;
+    const char *buf = mapFile(name, &len);
+    if (!buf) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Failed to open pack '%s': %s", name, strerror(errno));
+        return false;
+    }
+
+    if (!packOpenBuffer(pack, buf, len)) {
+        unmapFile(buf, len);
+        return false;
+    }
+    return true;
+}
+
+void packClose(Pack *pack)
+{
+    if (pack->data)
+        unmapFile(pack->data, pack->len);
+    memset(pack, 0, sizeof(Pack));
+}
+
+int packGetNumLevels(Pack *pack)
+{
+    return (int)pack->header->numLevels;
+}
+
+static const char *_getString(Pack *pack, uint32_t offset)
+{
+    return offset < pack->header->stringsSize ? pack->strings + offset : "";
+}
+
+const char *packGetName(Pack *pack, int index)
+{
+    return _getString(pack, pack->entries[index].nameOffset);
+}
+
+const char *packGetAuthor(Pack *pack, int index)
+{
+    return _getString(pack, pack->entries[index].authorOffset);
+}
+
+int packGetBoardSize(Pack *pack, int index)
+{
+    return pack->entries[index].boardSize;
+}
+
+uint64_t packGetHash(Pack *pack, int index)
+{
+    return pack->entries[index].hash;
+}
+
+uint64_t packHashSolution(const unsigned char *bits, int boardSize)
+{
+    uint16_t size = (uint16_t)boardSize;
+    uint64_t hash = hashBytes(&size, sizeof(size), HASH_SEED);
+    return hashBytes(bits, boardPackedSize(boardSize), hash);
+}
+
+bool packLoadLevel(Pack *pack, int index, Board *board, BoardMetadata *meta, BoardHints *hints)
+{
+    return packLoadLevelArena(pack, index, board, meta, hints, NULL);
+}
+
+// With an arena, everything the level needs comes from it, including the
+// copy of the clues
+bool packLoadLevelArena(Pack *pack, int index, Board *board, BoardMetadata *meta, BoardHints *hints, Arena *arena)
+{
+    if (index < 0 || index >= packGetNumLevels(pack))
+        return false;
+
+    const PackEntry *entry = &pack->entries[index];
+    size_t solutionSize = boardPackedSize(entry->boardSize);
+    if (entry->offset > pack->len || entry->dataSize > pack->len - entry->offset || solutionSize + entry->hintsSize > entry->dataSize) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Level %d lies outside the pack", index);
+        return false;
+    }
+
+    // the index stores the hash, so a damaged solution doesn't load as a different level
+    const unsigned char *data = (const unsigned char *)pack->data + entry->offset;
+    if (packHashSolution(data, entry->boardSize) != entry->hash) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Solution of level %d doesn't match its hash", index);
+        return false;
+    }
+    if (!boardLoadPackedArena(board, data, entry->boardSize, arena)) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Failed to load level %d", index);
+        return false;
+    }
+
+    const char *name = packGetName(pack, index);
+    const char *author = packGetAuthor(pack, index);
+    meta->arena = arena;
+    meta->name = arena ? arenaStrndup(arena, name, strlen(name)) : strdup(name);
+    meta->author = arena ? arenaStrndup(arena, author, strlen(author)) : strdup(author);
+    if (!meta->name || !meta->author) {
+        boardDestroy(board);
+        boardMetaDestroy(meta);
+        return false;
+    }
+
+    if (!hints)
+        return true;
+
+    bool ok;
+    if (entry->hintsSize > 0) {
+        // the clues may sit at an odd offset, so copy them out first
+        size_t count = entry->hintsSize / sizeof(uint16_t);
+        uint16_t *clues = arena ? (uint16_t *)arenaAlloc(arena, entry->hintsSize) : (uint16_t *)malloc(entry->hintsSize);
+        ok = clues != NULL;
+        if (ok) {
+            memcpy(clues, data + solutionSize, count * sizeof(uint16_t));
+            ok = hintsCreateFromCluesArena(hints, clues, count, entry->boardSize, arena);
+            if (!arena)
+                free(clues);
+        }
+        // everything that uses the clues assumes they come from the solution
+        if (ok && !hintsMatchBoard(hints, board)) {
+            LOG_MESSAGE(MTNLOG_ERROR, "pack", "Clues of level %d don't match its solution", index);
+            hintsDestroy(hints);
+            ok = false;
+        }
+    } else {
+        ok = hintsCreateArena(hints, board, arena);
+    }
+
+    if (!ok) {
+        boardDestroy(board);
+        boardMetaDestroy(meta);
+    }
+    return ok;
+}
+
+bool packWriterCreate(PackWriter *writer, bool withHints)
+{
+    memset(writer, 0, sizeof(PackWriter));
+    writer->withHints = withHints;
+    return true;
+}
+
+static bool _grow(void **buf, size_t *cap, size_t need, size_t elemSize)
+{
+    if (need <= *cap)
+        return true;
+    size_t newCap = *cap ? *cap : 64;
+    while (newCap < need)
+        newCap *= 2;
+    void *newBuf = realloc(*buf, newCap * elemSize);
+    if (!newBuf)
+        return false;
+    *buf = newBuf;
+    *cap = newCap;
+    return true;
+}
+
+static bool _addString(PackWriter *writer, const char *str, uint32_t *offset)
+{
+    if (!str)
+        str = "";
+    size_t len = strlen(str) + 1;
+    if (!_grow((void **)&writer->strings, &writer->stringsCap, writer->stringsSize + len, 1))
+        return false;
+    memcpy(writer->strings + writer->stringsSize, str, len);
+    *offset = (uint32_t)writer->stringsSize;
+    writer->stringsSize += len;
+    return true;
+}
+
+bool packWriterAdd(PackWriter *writer, Board *board, BoardMetadata *meta)
+{
+    size_t entriesCap = writer->entriesCap;
+    if (!_grow((void **)&writer->entries, &entriesCap, writer->numLevels + 1, sizeof(PackEntry)))
+        return false;
+    writer->entriesCap = (int)entriesCap;
+
+    PackEntry *entry = &writer->entries[writer->numLevels];
+    memset(entry, 0, sizeof(PackEntry));
+    entry->boardSize = (uint16_t)board->size;
+
+    BoardHints hints;
+    size_t numClues = 0;
+    if (writer->withHints) {
+        if (!hintsCreate(&hints, board))
+            return false;
+        numClues = hintsDataSize(&hints);
+    }
+
+    size_t solutionSize = boardPackedSize(board->size);
+    size_t dataSize = solutionSize + numClues * sizeof(uint16_t);
+    if (!_grow((void **)&writer->levelData, &writer->levelDataCap, writer->levelDataSize + dataSize, 1)) {
+        if (writer->withHints)
+            hintsDestroy(&hints);
+        return false;
+    }
+
+    unsigned char *data = writer->levelData + writer->levelDataSize;
+    boardPackSolution(board, data);
+    for (size_t i = 0; i < numClues; i++) {
+        uint16_t clue = (uint16_t)hints.data[i];
+        memcpy(data + solutionSize + i * sizeof(uint16_t), &clue, sizeof(clue));
+    }
+    if (writer->withHints)
+        hintsDestroy(&hints);
+
+    // offsets are relative to the level data until the pack is saved
+    entry->offset = writer->levelDataSize;
+    entry->dataSize = (uint32_t)dataSize;
+    entry->hintsSize = (uint32_t)(numClues * sizeof(uint16_t));
+    entry->hash = packHashSolution(data, board->size);
+    if (!_addString(writer, meta->name, &entry->nameOffset) || !_addString(writer, meta->author, &entry->authorOffset))
+        return false;
+
+    writer->levelDataSize += dataSize;
+    writer->numLevels++;
+    return true;
+}
+
+bool packWriterSave(PackWriter *writer, const char *name)
+{
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.numLevels = writer->numLevels;
+    header.flags = writer->withHints ? PackFlags_Hints : 0;
+    header.stringsOffset = sizeof(PackHeader) + (uint64_t)writer->numLevels * sizeof(PackEntry);
+    header.stringsSize = writer->stringsSize;
+
+    uint64_t dataOffset = header.stringsOffset + header.stringsSize;
+    for (int i = 0; i < writer->numLevels; i++)
+        writer->entries[i].offset += dataOffset;
+
+    FILE *fp = fopen(name, "wb");
+    bool ok = fp != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+        ok = ok && fwrite(writer->entries, sizeof(PackEntry), writer->numLevels, fp) == (size_t)writer->numLevels;
+        ok = ok && fwrite(writer->strings, 1, writer->stringsSize, fp) == writer->stringsSize;
+        ok = ok && fwrite(writer->levelData, 1, writer->levelDataSize, fp) == writer->levelDataSize;
+        ok = fclose(fp) == 0 && ok;
+    }
+
+    for (int i = 0; i < writer->numLevels; i++)
+        writer->entries[i].offset -= dataOffset;
+
+    if (!ok)
+        LOG_MESSAGE(MTNLOG_ERROR, "pack", "Failed to write pack '%s': %s", name, strerror(errno));
+    return ok;
+}
+
+void packWriterDestroy(PackWriter *writer)
+{
+    free(writer->entries);
+    free(writer->strings);
+    free(writer->levelData);
+    memset(writer, 0, sizeof(PackWriter));
+}
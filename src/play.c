@@ -0,0 +1,209 @@
+#include "play.h"
+#include "logger.h"
+#include <SDL2/SDL.h>
+#include <string.h>
+
+// Most clues in any row and in any column, that's how much room the camera
+// leaves for them
+static void _clueSpace(BoardHints *hints, int *clueW, int *clueH)
+{
+    *clueW = 0;
+    *clueH = 0;
+    if (!hints)
+        return;
+    for (int i = 0; i < hints->boardSize; i++) {
+        int rowCount, colCount;
+        hintsGetRow(hints, i, &rowCount);
+        hintsGetCol(hints, i, &colCount);
+        if (rowCount > *clueW)
+            *clueW = rowCount;
+        if (colCount > *clueH)
+            *clueH = colCount;
+    }
+}
+
+static void _fit(Play *play, int viewW, int viewH)
+{
+    int clueW, clueH;
+    _clueSpace(play->hints, &clueW, &clueH);
+    cameraFit(&play->camera, play->board->size, clueW, clueH, viewW, viewH);
+}
+
+// Keeps the callbacks, everything else starts over
+void playStart(Play *play, Board *board, BoardHints *hints, int viewW, int viewH)
+{
+    void (*onCellChanged)(void *, int, int) = play->onCellChanged;
+    void (*onSolved)(void *) = play->onSolved;
+    void *arg = play->arg;
+    memset(play, 0, sizeof(Play));
+    play->onCellChanged = onCellChanged;
+    play->onSolved = onSolved;
+    play->arg = arg;
+
+    play->board = board;
+    play->hints = hints;
+    play->solved = boardIsSolved(board);
+    _fit(play, viewW, viewH);
+}
+
+// A drag only changes cells that are still in the state the first cell was
+// in, so filling over a row doesn't wipe out its crosses
+static void _paintCell(Play *play, int x, int y)
+{
+    Board *board = play->board;
+    if (play->solved || x < 0 || y < 0 || x >= board->size || y >= board->size)
+        return;
+    if (boardGetCell(board, x, y) != play->paintFrom)
+        return;
+    boardSetCell(board, x, y, play->paintTo);
+    play->cellsChanged++;
+    if (play->onCellChanged)
+        play->onCellChanged(play->arg, x, y);
+
+    if (boardIsSolved(board)) {
+        play->solved = true;
+        play->painting = false;
+        if (play->onSolved)
+            play->onSolved(play->arg);
+    }
+}
+
+// Paints every cell on the line from the last painted cell to x, y, motion
+// events can be many cells apart when the mouse moves fast
+static void _paintLine(Play *play, int x, int y)
+{
+    int dx = x > play->paintX ? x - play->paintX : play->paintX - x;
+    int dy = y > play->paintY ? y - play->paintY : play->paintY - y;
+    int stepX = x > play->paintX ? 1 : -1;
+    int stepY = y > play->paintY ? 1 : -1;
+    int err = dx - dy;
+    int cx = play->paintX;
+    int cy = play->paintY;
+    while ((cx != x || cy != y) && play->painting) {
+        int err2 = 2 * err;
+        if (err2 > -dy) {
+            err -= dy;
+            cx += stepX;
+        }
+        if (err2 < dx) {
+            err += dx;
+            cy += stepY;
+        }
+        _paintCell(play, cx, cy);
+    }
+    play->paintX = x;
+    play->paintY = y;
+}
+
+static void _mouseDown(Play *play, int button, int mouseX, int mouseY)
+{
+    int x, y;
+    if (button != SDL_BUTTON_LEFT && button != SDL_BUTTON_RIGHT)
+        return;
+    if (play->solved)
+        return; // can't interact with board after solved
+    if (!cameraCellAt(&play->camera, mouseX, mouseY, &x, &y))
+        return;
+    LOG_MESSAGE(MTNLOG_INFO, "event", "Clicked on cell (%d,%d)", x, y);
+
+    // the first cell decides what the whole drag does
+    CellState oldState = boardGetCell(play->board, x, y);
+    CellState mark = button == SDL_BUTTON_LEFT ? CellState_Filled : CellState_Cross;
+    if (oldState == mark) {
+        play->paintFrom = mark;
+        play->paintTo = CellState_Empty;
+    } else if (oldState == CellState_Empty) {
+        play->paintFrom = CellState_Empty;
+        play->paintTo = mark;
+    } else {
+        return;
+    }
+    play->painting = true;
+    play->paintButton = button;
+    play->paintX = x;
+    play->paintY = y;
+    _paintCell(play, x, y);
+}
+
+static void _mouseUp(Play *play, int button)
+{
+    if (play->painting && button == play->paintButton)
+        play->painting = false;
+}
+
+// buttons is the SDL button mask at the time of the motion
+static bool _mouseMotion(Play *play, int mouseX, int mouseY, int xrel, int yrel, uint32_t buttons)
+{
+    // dragging with the middle button pans the board
+    if ((buttons & SDL_BUTTON_MMASK) && cameraPan(&play->camera, xrel, yrel))
+        return true;
+
+    // the button can come up outside the window without us hearing about it
+    if (play->painting && !(buttons & SDL_BUTTON(play->paintButton)))
+        play->painting = false;
+    if (play->painting) {
+        int x, y;
+        cameraCellAt(&play->camera, mouseX, mouseY, &x, &y);
+        if (x != play->paintX || y != play->paintY)
+            _paintLine(play, x, y);
+    }
+    return false;
+}
+
+static bool _mouseWheel(Play *play, int wheelY, int mouseX, int mouseY)
+{
+    if (wheelY == 0)
+        return false;
+    return cameraZoom(&play->camera, wheelY > 0 ? 1 : -1, mouseX, mouseY);
+}
+
+static bool _keyDown(Play *play, int32_t sym)
+{
+    Camera *camera = &play->camera;
+    switch (sym) {
+    case SDLK_LEFT:
+        return cameraPan(camera, PLAY_PAN_STEP, 0);
+    case SDLK_RIGHT:
+        return cameraPan(camera, -PLAY_PAN_STEP, 0);
+    case SDLK_UP:
+        return cameraPan(camera, 0, PLAY_PAN_STEP);
+    case SDLK_DOWN:
+        return cameraPan(camera, 0, -PLAY_PAN_STEP);
+    case SDLK_PLUS:
+    case SDLK_EQUALS:
+    case SDLK_KP_PLUS:
+        return cameraZoom(camera, 1, camera->viewW / 2, camera->viewH / 2);
+    case SDLK_MINUS:
+    case SDLK_KP_MINUS:
+        return cameraZoom(camera, -1, camera->viewW / 2, camera->viewH / 2);
+    case SDLK_0:
+        _fit(play, camera->viewW, camera->viewH);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Returns whether the camera moved, painted cells are reported through
+// onCellChanged
+bool playHandleEvent(Play *play, const PlayEvent *ev)
+{
+    switch (ev->type) {
+    case PlayEvent_MouseMotion:
+        return _mouseMotion(play, ev->x, ev->y, ev->xrel, ev->yrel, (uint32_t)ev->value);
+    case PlayEvent_MouseDown:
+        _mouseDown(play, ev->value, ev->x, ev->y);
+        return false;
+    case PlayEvent_MouseUp:
+        _mouseUp(play, ev->value);
+        return false;
+    case PlayEvent_MouseWheel:
+        return _mouseWheel(play, ev->value, ev->x, ev->y);
+    case PlayEvent_KeyDown:
+        return _keyDown(play, ev->value);
+    case PlayEvent_Resize:
+        cameraSetView(&play->camera, ev->x, ev->y);
+        return true;
+    }
+    return false;
+}
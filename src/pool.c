@@ -0,0 +1,158 @@
+#include "pool.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Every worker starts with an equal slice of the task range and takes tasks
+// from its front. A worker that runs dry steals the back half of the largest
+// remaining slice, so uneven tasks still keep every thread busy.
+typedef struct s_pool_slice {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} PoolSlice;
+
+typedef struct s_pool {
+    PoolSlice *slices;
+    int numThreads;
+    PoolTaskFunc func;
+    void *arg;
+} Pool;
+
+typedef struct s_pool_worker {
+    Pool *pool;
+    int index;
+} PoolWorker;
+
+int poolDefaultThreads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static bool _takeTask(PoolSlice *slice, int *task)
+{
+    bool ok = false;
+    pthread_mutex_lock(&slice->lock);
+    if (slice->next < slice->end) {
+        *task = slice->next++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&slice->lock);
+    return ok;
+}
+
+static int _tasksLeft(PoolSlice *slice)
+{
+    pthread_mutex_lock(&slice->lock);
+    int left = slice->end - slice->next;
+    pthread_mutex_unlock(&slice->lock);
+    return left;
+}
+
+static bool _steal(Pool *pool, int self)
+{
+    int victim = -1;
+    int most = 0;
+    for (int i = 0; i < pool->numThreads; i++) {
+        int left = i != self ? _tasksLeft(&pool->slices[i]) : 0;
+        if (left > most) {
+            most = left;
+            victim = i;
+        }
+    }
+    if (victim < 0)
+        return false;
+
+    // a single leftover task gets taken whole
+    PoolSlice *from = &pool->slices[victim];
+    PoolSlice *to = &pool->slices[self];
+    pthread_mutex_lock(&from->lock);
+    int hi = from->end;
+    int lo = from->next + (from->end - from->next) / 2;
+    from->end = lo;
+    pthread_mutex_unlock(&from->lock);
+
+    if (lo >= hi)
+        return true; // lost the race, look again
+    pthread_mutex_lock(&to->lock);
+    to->next = lo;
+    to->end = hi;
+    pthread_mutex_unlock(&to->lock);
+    return true;
+}
+
+static bool _anyLeft(Pool *pool)
+{
+    for (int i = 0; i < pool->numThreads; i++) {
+        if (_tasksLeft(&pool->slices[i]) > 0)
+            return true;
+    }
+    return false;
+}
+
+static void *_workerTask(void *arg)
+{
+    PoolWorker *worker = (PoolWorker *)arg;
+    Pool *pool = worker->pool;
+    int task;
+    while (true) {
+        while (_takeTask(&pool->slices[worker->index], &task))
+            pool->func(pool->arg, task, worker->index);
+        if (!_steal(pool, worker->index) && !_anyLeft(pool))
+            break;
+    }
+    return NULL;
+}
+
+bool poolRun(int numThreads, int numTasks, PoolTaskFunc func, void *arg)
+{
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > numTasks)
+        numThreads = numTasks > 0 ? numTasks : 1;
+
+    Pool pool;
+    pool.numThreads = numThreads;
+    pool.func = func;
+    pool.arg = arg;
+    pool.slices = (PoolSlice *)malloc(numThreads * sizeof(PoolSlice));
+    PoolWorker *workers = (PoolWorker *)malloc(numThreads * sizeof(PoolWorker));
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    if (!pool.slices || !workers || !threads) {
+        LOG_MESSAGE(MTNLOG_ERROR, "pool", "Failed to allocate thread pool");
+        free(pool.slices);
+        free(workers);
+        free(threads);
+        return false;
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        pthread_mutex_init(&pool.slices[i].lock, NULL);
+        pool.slices[i].next = (int)((long long)numTasks * i / numThreads);
+        pool.slices[i].end = (int)((long long)numTasks * (i + 1) / numThreads);
+        workers[i].pool = &pool;
+        workers[i].index = i;
+    }
+
+    // the calling thread works as worker 0
+    int started = 1;
+    for (; started < numThreads; started++) {
+        int code = pthread_create(&threads[started], NULL, _workerTask, &workers[started]);
+        if (code != 0) {
+            LOG_MESSAGE(MTNLOG_WARNING, "pool", "Failed to create worker thread (error %d)", code);
+            break;
+        }
+    }
+    _workerTask(&workers[0]);
+    for (int i = 1; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < numThreads; i++)
+        pthread_mutex_destroy(&pool.slices[i].lock);
+    free(pool.slices);
+    free(workers);
+    free(threads);
+    return true;
+}
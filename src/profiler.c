@@ -0,0 +1,181 @@
+#include "profiler.h"
+#include "util.h"
+#include "logger.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Only the owning thread writes a ring. head counts every event ever
+// recorded, so the ring holds the last min(head, PROFILER_RING_SIZE) of them.
+typedef struct s_profiler_ring {
+    ProfilerEvent *events;
+    atomic_uint_fast64_t head;
+} ProfilerRing;
+
+static ProfilerRing _rings[PROFILER_MAX_THREADS];
+static atomic_int _numRings;
+static atomic_uint_fast64_t _allocs;
+static atomic_uint_fast64_t _allocBytes;
+static _Thread_local ProfilerRing *_ring = NULL;
+static _Thread_local bool _ringFailed = false;
+
+static ProfilerRing *_getRing(void)
+{
+    if (_ring || _ringFailed)
+        return _ring;
+
+    // claiming a slot is the only shared step, and it's a single atomic add
+    int index = atomic_fetch_add(&_numRings, 1);
+    ProfilerEvent *events = index < PROFILER_MAX_THREADS ? (ProfilerEvent *)calloc(PROFILER_RING_SIZE, sizeof(ProfilerEvent)) : NULL;
+    if (!events) {
+        _ringFailed = true;
+        LOG_MESSAGE(MTNLOG_WARNING, "profiler", "Not profiling thread %d", index);
+        return NULL;
+    }
+    _rings[index].events = events;
+    _ring = &_rings[index];
+    return _ring;
+}
+
+ProfilerScope profilerBegin(const char *name)
+{
+    ProfilerScope scope;
+    scope.name = name;
+    scope.startNs = monotonicNs();
+    return scope;
+}
+
+void profilerEnd(ProfilerScope *scope)
+{
+    uint64_t end = monotonicNs();
+    ProfilerRing *ring = _getRing();
+    if (!ring)
+        return;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ProfilerEvent *ev = &ring->events[head & (PROFILER_RING_SIZE - 1)];
+    ev->name = scope->name;
+    ev->startNs = scope->startNs;
+    ev->durationNs = end - scope->startNs;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void profilerCountAlloc(size_t bytes)
+{
+    atomic_fetch_add_explicit(&_allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_allocBytes, bytes, memory_order_relaxed);
+}
+
+uint64_t profilerGetAllocs(void)
+{
+    return atomic_load(&_allocs);
+}
+
+uint64_t profilerGetAllocBytes(void)
+{
+    return atomic_load(&_allocBytes);
+}
+
+// Sums the events named name that the calling thread started at or after
+// sinceNs
+double profilerTotalMs(const char *name, uint64_t sinceNs, int *count)
+{
+    ProfilerRing *ring = _getRing();
+    uint64_t total = 0;
+    int found = 0;
+    if (ring) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for (uint64_t i = head; i > first; i--) {
+            ProfilerEvent *ev = &ring->events[(i - 1) & (PROFILER_RING_SIZE - 1)];
+            if (ev->startNs < sinceNs)
+                break;
+            if (ev->name == name || strcmp(ev->name, name) == 0) {
+                total += ev->durationNs;
+                found++;
+            }
+        }
+    }
+    if (count)
+        *count = found;
+    return total / 1e6;
+}
+
+static void _writeJsonName(FILE *fp, const char *name)
+{
+    fputc('"', fp);
+    for (; *name; name++) {
+        if (*name == '"' || *name == '\\')
+            fputc('\\', fp);
+        fputc(*name, fp);
+    }
+    fputc('"', fp);
+}
+
+// Writes every event still in the rings in Chrome's trace event format, which
+// chrome://tracing and Perfetto can open
+bool profilerWriteTrace(const char *name)
+{
+    FILE *fp = fopen(name, "w");
+    if (!fp) {
+        LOG_MESSAGE(MTNLOG_ERROR, "profiler", "Failed to create trace file '%s'", name);
+        return false;
+    }
+
+    int numRings = atomic_load(&_numRings);
+    if (numRings > PROFILER_MAX_THREADS)
+        numRings = PROFILER_MAX_THREADS;
+
+    // timestamps start at the oldest event so the numbers stay readable
+    uint64_t base = UINT64_MAX;
+    for (int r = 0; r < numRings; r++) {
+        ProfilerRing *ring = &_rings[r];
+        uint64_t head = ring->events ? atomic_load_explicit(&ring->head, memory_order_acquire) : 0;
+        uint64_t first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            uint64_t start = ring->events[i & (PROFILER_RING_SIZE - 1)].startNs;
+            if (start < base)
+                base = start;
+        }
+    }
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    bool firstEvent = true;
+    for (int r = 0; r < numRings; r++) {
+        ProfilerRing *ring = &_rings[r];
+        if (!ring->events)
+            continue;
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", firstEvent ? "" : ",\n", r, r);
+        firstEvent = false;
+
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            ProfilerEvent *ev = &ring->events[i & (PROFILER_RING_SIZE - 1)];
+            fprintf(fp, ",\n{\"name\":");
+            _writeJsonName(fp, ev->name);
+            fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", r, (ev->startNs - base) / 1e3, ev->durationNs / 1e3);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    bool ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (ok)
+        LOG_MESSAGE(MTNLOG_INFO, "profiler", "Wrote trace to '%s'", name);
+    return ok;
+}
+
+// Frees every ring, no thread may be recording anymore
+void profilerShutdown(void)
+{
+    int numRings = atomic_load(&_numRings);
+    for (int r = 0; r < numRings && r < PROFILER_MAX_THREADS; r++) {
+        free(_rings[r].events);
+        _rings[r].events = NULL;
+        atomic_store(&_rings[r].head, 0);
+    }
+    atomic_store(&_numRings, 0);
+    _ring = NULL;
+}
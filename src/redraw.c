@@ -0,0 +1,59 @@
+#include "redraw.h"
+#include <string.h>
+
+void redrawInit(Redraw *redraw)
+{
+    memset(redraw, 0, sizeof(Redraw));
+    redraw->full = true;
+}
+
+void redrawMarkAll(Redraw *redraw)
+{
+    redraw->full = true;
+}
+
+void redrawMark(Redraw *redraw, SDL_Rect rect)
+{
+    if (redraw->full || rect.w <= 0 || rect.h <= 0)
+        return;
+
+    // skip regions that are already covered, hovering back and forth marks
+    // the same rows over and over
+    for (int i = 0; i < redraw->numRegions; i++) {
+        SDL_Rect *r = &redraw->regions[i];
+        if (rect.x >= r->x && rect.y >= r->y && rect.x + rect.w <= r->x + r->w && rect.y + rect.h <= r->y + r->h)
+            return;
+    }
+
+    // a region costs a whole scene pass, so it merges into its bounding rect
+    // with another one whenever that draws fewer than REDRAW_PASS_AREA extra
+    // pixels; the merged rect may then merge with the others again
+    for (int i = 0; i < redraw->numRegions;) {
+        SDL_Rect *r = &redraw->regions[i];
+        SDL_Rect merged;
+        SDL_UnionRect(r, &rect, &merged);
+        if ((long)merged.w * merged.h <= (long)r->w * r->h + (long)rect.w * rect.h + REDRAW_PASS_AREA) {
+            rect = merged;
+            redraw->regions[i] = redraw->regions[--redraw->numRegions];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (redraw->numRegions == REDRAW_MAX_REGIONS)
+        redraw->full = true;
+    else
+        redraw->regions[redraw->numRegions++] = rect;
+}
+
+bool redrawPending(Redraw *redraw)
+{
+    return redraw->full || redraw->numRegions > 0;
+}
+
+void redrawClear(Redraw *redraw)
+{
+    redraw->numRegions = 0;
+    redraw->full = false;
+}
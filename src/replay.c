@@ -0,0 +1,272 @@
+#include "replay.h"
+#include "util.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE 20
+#define END_RECORD 0
+
+static void _putVarint(unsigned char **p, uint32_t value)
+{
+    while (value >= 0x80) {
+        *(*p)++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *(*p)++ = (unsigned char)value;
+}
+
+static void _putSigned(unsigned char **p, int32_t value)
+{
+    _putVarint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static bool _getVarint(const unsigned char **p, const unsigned char *end, uint32_t *value)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p == end)
+            return false;
+        unsigned char byte = *(*p)++;
+        result |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool _getSigned(const unsigned char **p, const unsigned char *end, int32_t *value)
+{
+    uint32_t raw;
+    if (!_getVarint(p, end, &raw))
+        return false;
+    *value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+    return true;
+}
+
+// How many of x, y, xrel, yrel and value an event type stores
+static int _numFields(int type)
+{
+    switch (type) {
+    case PlayEvent_MouseMotion:
+        return 5;
+    case PlayEvent_MouseDown:
+    case PlayEvent_MouseUp:
+    case PlayEvent_MouseWheel:
+        return 3;
+    case PlayEvent_KeyDown:
+        return 1;
+    case PlayEvent_Resize:
+        return 2;
+    }
+    return -1;
+}
+
+// Covers every cell state, so two boards hash the same when they look the same
+uint64_t replayBoardHash(Board *board)
+{
+    size_t bytes = (size_t)board->size * board->wordsPerLine * sizeof(uint64_t);
+    uint64_t hash = hashBytes(board->filled, bytes, HASH_SEED);
+    return hashBytes(board->crosses, bytes, hash);
+}
+
+bool replayWriterOpen(ReplayWriter *writer, const char *name, Board *board, int viewW, int viewH)
+{
+    memset(writer, 0, sizeof(ReplayWriter));
+    size_t bitsLen = boardPackedSize(board->size);
+    unsigned char *bits = (unsigned char *)malloc(bitsLen);
+    writer->fp = bits ? fopen(name, "wb") : NULL;
+    if (!writer->fp) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Failed to create recording '%s'", name);
+        free(bits);
+        return false;
+    }
+
+    uint32_t version = REPLAY_VERSION;
+    int32_t header[3] = {board->size, viewW, viewH};
+    boardPackSolution(board, bits);
+    bool ok = fwrite(REPLAY_MAGIC, 1, 4, writer->fp) == 4 && fwrite(&version, 4, 1, writer->fp) == 1
+        && fwrite(header, 4, 3, writer->fp) == 3 && fwrite(bits, 1, bitsLen, writer->fp) == bitsLen;
+    free(bits);
+    if (!ok) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Failed to write recording '%s'", name);
+        fclose(writer->fp);
+        writer->fp = NULL;
+        return false;
+    }
+    writer->startNs = monotonicNs();
+    LOG_MESSAGE(MTNLOG_INFO, "replay", "Recording to '%s'", name);
+    return true;
+}
+
+bool replayWriterAdd(ReplayWriter *writer, const PlayEvent *ev)
+{
+    if (!writer->fp)
+        return false;
+    unsigned char buf[1 + 5 * 6];
+    unsigned char *p = buf;
+    uint32_t now = (uint32_t)((monotonicNs() - writer->startNs) / 1000000);
+    int32_t fields[5] = {ev->x, ev->y, ev->xrel, ev->yrel, ev->value};
+    int numFields = _numFields(ev->type);
+
+    *p++ = (unsigned char)ev->type;
+    _putVarint(&p, now - writer->lastMs);
+    if (numFields == 1) {
+        _putSigned(&p, ev->value); // keys only have a value
+    } else if (numFields == 3) {
+        _putSigned(&p, ev->x);
+        _putSigned(&p, ev->y);
+        _putSigned(&p, ev->value);
+    } else {
+        for (int i = 0; i < numFields; i++)
+            _putSigned(&p, fields[i]);
+    }
+    writer->lastMs = now;
+    writer->numEvents++;
+    return fwrite(buf, 1, p - buf, writer->fp) == (size_t)(p - buf);
+}
+
+// The end record is what makes a recording complete, one without it got cut
+// off
+bool replayWriterClose(ReplayWriter *writer, Board *board)
+{
+    if (!writer->fp)
+        return false;
+    unsigned char buf[1 + 5 + 8 + 1];
+    unsigned char *p = buf;
+    uint32_t now = (uint32_t)((monotonicNs() - writer->startNs) / 1000000);
+    uint64_t hash = replayBoardHash(board);
+    *p++ = END_RECORD;
+    _putVarint(&p, now - writer->lastMs);
+    memcpy(p, &hash, 8);
+    p += 8;
+    *p++ = boardIsSolved(board);
+
+    bool ok = fwrite(buf, 1, p - buf, writer->fp) == (size_t)(p - buf);
+    ok = fclose(writer->fp) == 0 && ok;
+    writer->fp = NULL;
+    if (ok)
+        LOG_MESSAGE(MTNLOG_INFO, "replay", "Recorded %ld events", writer->numEvents);
+    else
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Failed to finish recording");
+    return ok;
+}
+
+// Decodes one event, returns false at the end record or on bad data
+static bool _decode(const unsigned char **p, const unsigned char *end, PlayEvent *ev, uint32_t *deltaMs, bool *isEnd)
+{
+    *isEnd = false;
+    if (*p == end)
+        return false;
+    int type = *(*p)++;
+    if (!_getVarint(p, end, deltaMs))
+        return false;
+    if (type == END_RECORD) {
+        *isEnd = true;
+        return false;
+    }
+
+    int numFields = _numFields(type);
+    int32_t fields[5] = {0, 0, 0, 0, 0};
+    if (numFields < 0)
+        return false;
+    for (int i = 0; i < numFields; i++) {
+        if (!_getSigned(p, end, &fields[i]))
+            return false;
+    }
+
+    memset(ev, 0, sizeof(PlayEvent));
+    ev->type = (PlayEventType)type;
+    if (numFields == 1) {
+        ev->value = fields[0];
+    } else if (numFields == 3) {
+        ev->x = fields[0];
+        ev->y = fields[1];
+        ev->value = fields[2];
+    } else {
+        ev->x = fields[0];
+        ev->y = fields[1];
+        ev->xrel = fields[2];
+        ev->yrel = fields[3];
+        ev->value = fields[4];
+    }
+    return true;
+}
+
+// Maps the recording and checks it all the way to the end record
+bool replayOpen(Replay *replay, const char *name)
+{
+    memset(replay, 0, sizeof(Replay));
+    replay->data = (const unsigned char *)mapFile(name, &replay->len);
+    if (!replay->data) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Failed to open recording '%s'", name);
+        return false;
+    }
+
+    uint32_t version;
+    int32_t header[3];
+    const unsigned char *end = replay->data + replay->len;
+    if (replay->len < HEADER_SIZE || memcmp(replay->data, REPLAY_MAGIC, 4) != 0) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "'%s' is not a recording", name);
+        replayClose(replay);
+        return false;
+    }
+    memcpy(&version, replay->data + 4, 4);
+    memcpy(header, replay->data + 8, 12);
+    if (version != REPLAY_VERSION || header[0] <= 0 || header[0] > BOARD_MAX_SIZE
+        || boardPackedSize(header[0]) > (size_t)(end - replay->data - HEADER_SIZE)) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Unsupported or broken recording '%s'", name);
+        replayClose(replay);
+        return false;
+    }
+    replay->boardSize = header[0];
+    replay->viewW = header[1];
+    replay->viewH = header[2];
+    replay->solution = replay->data + HEADER_SIZE;
+    replay->events = replay->solution + boardPackedSize(replay->boardSize);
+    replay->next = replay->events;
+
+    const unsigned char *p = replay->events;
+    PlayEvent ev;
+    uint32_t deltaMs;
+    bool isEnd;
+    while (_decode(&p, end, &ev, &deltaMs, &isEnd)) {
+        replay->numEvents++;
+        replay->durationMs += deltaMs;
+    }
+    if (!isEnd || end - p < 9) {
+        LOG_MESSAGE(MTNLOG_ERROR, "replay", "Recording '%s' is cut off after %ld events", name, replay->numEvents);
+        replayClose(replay);
+        return false;
+    }
+    replay->durationMs += deltaMs;
+    memcpy(&replay->finalHash, p, 8);
+    replay->finalSolved = p[8] != 0;
+    return true;
+}
+
+void replayClose(Replay *replay)
+{
+    if (replay->data)
+        unmapFile((const char *)replay->data, replay->len);
+    memset(replay, 0, sizeof(Replay));
+}
+
+bool replayLoadBoard(Replay *replay, Board *board)
+{
+    return boardLoadPacked(board, replay->solution, replay->boardSize);
+}
+
+void replayRewind(Replay *replay)
+{
+    replay->next = replay->events;
+}
+
+// deltaMs is the time since the previous event when it was recorded
+bool replayNext(Replay *replay, PlayEvent *ev, uint32_t *deltaMs)
+{
+    bool isEnd;
+    return _decode(&replay->next, replay->data + replay->len, ev, deltaMs, &isEnd);
+}
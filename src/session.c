@@ -0,0 +1,110 @@
+#include "session.h"
+#include "logger.h"
+#include <string.h>
+
+bool sessionLoad(Session *session, const char *buf, size_t len, BoardLoadError *err)
+{
+    memset(session, 0, sizeof(Session));
+    session->loaded = boardLoadBuffer(&session->board, &session->meta, buf, len, err);
+    return session->loaded;
+}
+
+bool sessionLoadPacked(Session *session, const unsigned char *bits, int size)
+{
+    memset(session, 0, sizeof(Session));
+    session->loaded = boardLoadPacked(&session->board, bits, size);
+    return session->loaded;
+}
+
+// Uses the pack's clues when it has them
+bool sessionLoadPack(Session *session, Pack *pack, int index)
+{
+    memset(session, 0, sizeof(Session));
+    bool withHints = pack->header->flags & PackFlags_Hints;
+    session->loaded = packLoadLevel(pack, index, &session->board, &session->meta, withHints ? &session->hints : NULL);
+    session->hasHints = session->loaded && withHints;
+    return session->loaded;
+}
+
+void sessionDestroy(Session *session)
+{
+    if (session->hasSolver)
+        solverDestroy(&session->solver);
+    if (session->hasHints)
+        hintsDestroy(&session->hints);
+    if (session->loaded) {
+        boardDestroy(&session->board);
+        boardMetaDestroy(&session->meta);
+    }
+    memset(session, 0, sizeof(Session));
+}
+
+// Checks a move and applies it if it's valid. Moves that don't change the cell
+// are valid but don't count.
+SessionMoveResult sessionApplyMove(Session *session, int x, int y, CellState state)
+{
+    Board *board = &session->board;
+    if (!session->loaded)
+        return SessionMoveResult_NotLoaded;
+    if (x < 0 || y < 0 || x >= board->size || y >= board->size)
+        return SessionMoveResult_OutOfBounds;
+    if (state != CellState_Empty && state != CellState_Filled && state != CellState_Cross)
+        return SessionMoveResult_BadState;
+    if (boardIsSolved(board))
+        return SessionMoveResult_AlreadySolved;
+
+    if (boardGetCell(board, x, y) == state)
+        return SessionMoveResult_OK;
+    boardSetCell(board, x, y, state);
+    session->moves++;
+    return boardIsSolved(board) ? SessionMoveResult_Solved : SessionMoveResult_OK;
+}
+
+bool sessionIsSolved(Session *session)
+{
+    return session->loaded && boardIsSolved(&session->board);
+}
+
+const BoardHints *sessionGetHints(Session *session)
+{
+    if (!session->hasHints && session->loaded)
+        session->hasHints = hintsCreate(&session->hints, &session->board);
+    return session->hasHints ? &session->hints : NULL;
+}
+
+// Line solves the level from its clues alone, the grid it got to is left in
+// session->solver
+SolveResult sessionSolve(Session *session)
+{
+    if (!sessionGetHints(session))
+        return SolveResult_AllocationError;
+    if (!session->hasSolver) {
+        session->hasSolver = solverCreate(&session->solver, session->board.size);
+        if (!session->hasSolver)
+            return SolveResult_AllocationError;
+    }
+    solverReset(&session->solver);
+    SolveResult result = solverSolve(&session->solver, &session->hints);
+    if (result == SolveResult_Contradiction)
+        LOG_MESSAGE(MTNLOG_WARNING, "session", "Clues of a %dx%d level contradict each other", session->board.size, session->board.size);
+    return result;
+}
+
+const char *sessionMoveResultString(SessionMoveResult result)
+{
+    switch (result) {
+    case SessionMoveResult_OK:
+        return "ok";
+    case SessionMoveResult_Solved:
+        return "solved";
+    case SessionMoveResult_AlreadySolved:
+        return "already-solved";
+    case SessionMoveResult_OutOfBounds:
+        return "out-of-bounds";
+    case SessionMoveResult_BadState:
+        return "bad-state";
+    case SessionMoveResult_NotLoaded:
+        return "not-loaded";
+    }
+    return "unknown";
+}
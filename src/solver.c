@@ -0,0 +1,584 @@
+#include "solver.h"
+#include "bitset.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// memory for the line cache of solverCheckUnique
+#define SOLVER_CACHE_BYTES (1 << 20)
+
+bool solverCreate(Solver *solver, int size)
+{
+    if (size <= 0) {
+        LOG_MESSAGE(MTNLOG_ERROR, "solver", "Invalid board size %d", size);
+        return false;
+    }
+
+    size_t tableSize = (size_t)(MAX_HINTS(size) + 1) * (size + 1);
+
+    memset(solver, 0, sizeof(Solver));
+    solver->size = size;
+    solver->grid = (unsigned char *)malloc((size_t)size * size);
+    solver->line = (unsigned char *)malloc(size);
+    solver->canEmpty = (unsigned char *)malloc(size);
+    solver->open = (unsigned char *)malloc(size + 1);
+    solver->fwd = (unsigned char *)malloc(tableSize);
+    solver->bwd = (unsigned char *)malloc(tableSize);
+    solver->emptyPrefix = (int *)malloc((size + 1) * sizeof(int));
+    solver->fill = (int *)malloc((size + 1) * sizeof(int));
+    solver->queue = (int *)malloc(2 * size * sizeof(int));
+    solver->queued = (bool *)malloc(2 * size * sizeof(bool));
+
+    if (!solver->grid || !solver->line || !solver->canEmpty || !solver->open || !solver->fwd || !solver->bwd || !solver->emptyPrefix || !solver->fill || !solver->queue || !solver->queued) {
+        LOG_MESSAGE(MTNLOG_ERROR, "solver", "Failed to allocate solver buffers");
+        solverDestroy(solver);
+        return false;
+    }
+
+    memset(solver->grid, CellState_Empty, (size_t)size * size);
+    solver->unknown = size * size;
+    return true;
+}
+
+void solverDestroy(Solver *solver)
+{
+    free(solver->grid);
+    free(solver->line);
+    free(solver->canEmpty);
+    free(solver->open);
+    free(solver->fwd);
+    free(solver->bwd);
+    free(solver->emptyPrefix);
+    free(solver->fill);
+    free(solver->queue);
+    free(solver->queued);
+    memset(solver, 0, sizeof(Solver));
+}
+
+void solverLoadBoard(Solver *solver, Board *board)
+{
+    solver->unknown = 0;
+    for (int y = 0; y < solver->size; y++) {
+        for (int x = 0; x < solver->size; x++) {
+            CellState st = boardGetCell(board, x, y);
+            solver->grid[x + y * solver->size] = (unsigned char)st;
+            if (st == CellState_Empty)
+                solver->unknown++;
+        }
+    }
+}
+
+void solverReset(Solver *solver)
+{
+    memset(solver->grid, CellState_Empty, (size_t)solver->size * solver->size);
+    solver->unknown = solver->size * solver->size;
+}
+
+CellState solverGetCell(Solver *solver, int x, int y)
+{
+    return (CellState)solver->grid[x + y * solver->size];
+}
+
+bool solverMatchesSolution(Solver *solver, Board *board)
+{
+    for (int y = 0; y < solver->size; y++) {
+        const uint64_t *row = board->solved + y * board->wordsPerLine;
+        for (int x = 0; x < solver->size; x++) {
+            bool filled = solver->grid[x + y * solver->size] == CellState_Filled;
+            if (filled != bitsetGet(row, x))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Checks a line with no unknown cells against its clues
+static bool _lineMatches(const int *clues, int k, const unsigned char *line, int n)
+{
+    int block = 0;
+    int run = 0;
+    for (int i = 0; i <= n; i++) {
+        if (i < n && line[i] == CellState_Filled) {
+            run++;
+        } else if (run > 0) {
+            if (block >= k || clues[block] != run)
+                return false;
+            block++;
+            run = 0;
+        }
+    }
+    return block == k;
+}
+
+// Solves one line in place. fwd[j][i] tells whether the first j blocks fit
+// into cells [0, i), bwd[j][i] whether blocks j..k-1 fit into [i, n). A cell
+// can be filled if some block covers it in a placement allowed by both tables,
+// and it can be empty if the tables meet around it. Returns the number of newly
+// known cells, or -1 if the line contradicts its clues.
+static int _solveLine(Solver *solver, const int *clues, int k, unsigned char *line, int n)
+{
+    int stride = n + 1;
+    unsigned char *fwd = solver->fwd;
+    unsigned char *bwd = solver->bwd;
+    int *empties = solver->emptyPrefix;
+    int *fill = solver->fill;
+    int unknown = 0;
+
+    // open[i + 1] tells whether cell i may be empty, which keeps the loops
+    // below free of branches
+    unsigned char *open = solver->open;
+    empties[0] = 0;
+    open[0] = 1;
+    for (int i = 0; i < n; i++) {
+        empties[i + 1] = empties[i] + (line[i] == CellState_Cross);
+        open[i + 1] = line[i] != CellState_Filled;
+        unknown += line[i] == CellState_Empty;
+    }
+    if (unknown == 0)
+        return _lineMatches(clues, k, line, n) ? 0 : -1;
+
+    fwd[0] = 1;
+    for (int i = 1; i <= n; i++)
+        fwd[i] = fwd[i - 1] & open[i];
+    for (int j = 1; j <= k; j++) {
+        int c = clues[j - 1];
+        unsigned char *row = fwd + j * stride;
+        unsigned char *prev = row - stride;
+        if (c <= 0 || c > n)
+            return -1;
+        row[0] = 0;
+        for (int i = 1; i < c; i++)
+            row[i] = 0;
+        row[c] = (empties[c] == 0) & prev[0];
+        for (int i = c + 1; i <= n; i++)
+            row[i] = (row[i - 1] & open[i]) | ((empties[i] == empties[i - c]) & open[i - c] & prev[i - c - 1]);
+    }
+    if (!fwd[k * stride + n])
+        return -1;
+
+    unsigned char *last = bwd + k * stride;
+    last[n] = 1;
+    for (int i = n - 1; i >= 0; i--)
+        last[i] = last[i + 1] & open[i + 1];
+    for (int j = k - 1; j >= 0; j--) {
+        int c = clues[j];
+        unsigned char *row = bwd + j * stride;
+        unsigned char *next = row + stride;
+        row[n] = 0;
+        for (int i = n - 1; i > n - c; i--)
+            row[i] = 0;
+        row[n - c] = (empties[n] == empties[n - c]) & next[n];
+        for (int i = n - c - 1; i >= 0; i--)
+            row[i] = (row[i + 1] & open[i + 1]) | ((empties[i + c] == empties[i]) & open[i + c + 1] & next[i + c + 1]);
+    }
+
+    // mark every cell some valid block placement covers
+    memset(fill, 0, (n + 1) * sizeof(int));
+    for (int j = 0; j < k; j++) {
+        int c = clues[j];
+        const unsigned char *left = fwd + j * stride;
+        const unsigned char *right = bwd + (j + 1) * stride;
+        for (int p = 0; p + c <= n; p++) {
+            int e = p + c;
+            int leftOk = p == 0 ? left[0] : open[p] & left[p - 1];
+            int rightOk = e == n ? right[n] : open[e + 1] & right[e + 1];
+            int valid = (empties[e] == empties[p]) & leftOk & rightOk;
+            fill[p] += valid;
+            fill[e] -= valid;
+        }
+    }
+
+    // a cell can be empty if the first j blocks fit before it and the rest after it
+    unsigned char *canEmpty = solver->canEmpty;
+    memset(canEmpty, 0, n);
+    for (int j = 0; j <= k; j++) {
+        const unsigned char *before = fwd + j * stride;
+        const unsigned char *after = bwd + j * stride + 1;
+        for (int i = 0; i < n; i++)
+            canEmpty[i] |= before[i] & after[i];
+    }
+
+    int changed = 0;
+    int covered = 0;
+    for (int i = 0; i < n; i++) {
+        covered += fill[i];
+        bool canFill = covered > 0;
+        bool empty = canEmpty[i] && line[i] != CellState_Filled;
+
+        if (!canFill && !empty)
+            return -1;
+        if (line[i] == CellState_Empty) {
+            if (!empty) {
+                line[i] = CellState_Filled;
+                changed++;
+            } else if (!canFill) {
+                line[i] = CellState_Cross;
+                changed++;
+            }
+        }
+    }
+    return changed;
+}
+
+// lines 0..size-1 are rows, size..2*size-1 are columns
+static void _enqueueLine(Solver *solver, int line)
+{
+    if (solver->queued[line])
+        return;
+    int cap = 2 * solver->size;
+    solver->queue[(solver->queueHead + solver->queueLen) % cap] = line;
+    solver->queueLen++;
+    solver->queued[line] = true;
+}
+
+static int _dequeueLine(Solver *solver)
+{
+    int line = solver->queue[solver->queueHead];
+    solver->queueHead = (solver->queueHead + 1) % (2 * solver->size);
+    solver->queueLen--;
+    solver->queued[line] = false;
+    return line;
+}
+
+// _solveLine on solver->line, through the cache when there is one
+static int _solveLineCached(Solver *solver, int id, const int *clues, int k)
+{
+    int n = solver->size;
+    if (!solver->cache)
+        return _solveLine(solver, clues, k, solver->line, n);
+
+    uint64_t hash = 14695981039346656037ull ^ (uint64_t)id;
+    for (int i = 0; i < n; i++)
+        hash = (hash ^ solver->line[i]) * 1099511628211ull;
+    hash |= 1;
+    LineCacheEntry *entry = solver->cache + ((hash >> 32) & (uint64_t)(solver->cacheSlots - 1));
+    unsigned char *before = solver->cacheCells + (size_t)(entry - solver->cache) * 2 * n;
+    unsigned char *after = before + n;
+    if (entry->hash == hash && entry->line == id && memcmp(before, solver->line, n) == 0) {
+        if (entry->result > 0)
+            memcpy(solver->line, after, n);
+        return entry->result;
+    }
+
+    entry->hash = hash;
+    entry->line = id;
+    memcpy(before, solver->line, n);
+    entry->result = _solveLine(solver, clues, k, solver->line, n);
+    if (entry->result > 0)
+        memcpy(after, solver->line, n);
+    return entry->result;
+}
+
+static SolveResult _propagate(Solver *solver, BoardHints *hints)
+{
+    int size = solver->size;
+    while (solver->queueLen > 0) {
+        int id = _dequeueLine(solver);
+        bool isRow = id < size;
+        int idx = isRow ? id : id - size;
+        int step = isRow ? 1 : size;
+        unsigned char *first = solver->grid + (isRow ? idx * size : idx);
+
+        for (int i = 0; i < size; i++)
+            solver->line[i] = first[i * step];
+
+        int numClues;
+        const int *clues = isRow ? hintsGetRow(hints, idx, &numClues) : hintsGetCol(hints, idx, &numClues);
+        int changed = _solveLineCached(solver, id, clues, numClues);
+        solver->steps++;
+        if (changed < 0) {
+            while (solver->queueLen > 0)
+                _dequeueLine(solver);
+            return SolveResult_Contradiction;
+        }
+        if (changed == 0)
+            continue;
+
+        for (int i = 0; i < size; i++) {
+            if (first[i * step] != solver->line[i]) {
+                first[i * step] = solver->line[i];
+                _enqueueLine(solver, isRow ? size + i : i);
+            }
+        }
+        solver->unknown -= changed;
+    }
+
+    return solver->unknown == 0 ? SolveResult_Solved : SolveResult_Stuck;
+}
+
+SolveResult solverSolve(Solver *solver, BoardHints *hints)
+{
+    if (hints->boardSize != solver->size) {
+        LOG_MESSAGE(MTNLOG_ERROR, "solver", "Hints are for size %d but solver is for size %d", hints->boardSize, solver->size);
+        return SolveResult_Contradiction;
+    }
+
+    solver->queueHead = 0;
+    solver->queueLen = 0;
+    memset(solver->queued, 0, 2 * solver->size * sizeof(bool));
+    for (int i = 0; i < 2 * solver->size; i++)
+        _enqueueLine(solver, i);
+
+    return _propagate(solver, hints);
+}
+
+// Search state for solverCheckUnique
+typedef struct s_search {
+    Solver *solver;
+    BoardHints *hints;
+    unsigned char *solutions[2];
+    int numSolutions;
+    long maxProbes;
+    bool aborted;
+} Search;
+
+// Returns false once a second, different solution turns up
+static bool _recordSolution(Search *search)
+{
+    size_t cells = (size_t)search->solver->size * search->solver->size;
+    if (search->numSolutions == 1 && memcmp(search->solutions[0], search->solver->grid, cells) == 0)
+        return true;
+    memcpy(search->solutions[search->numSolutions++], search->solver->grid, cells);
+    return search->numSolutions < 2;
+}
+
+static SolveResult _assume(Search *search, int cell, unsigned char value)
+{
+    Solver *solver = search->solver;
+    solver->grid[cell] = value;
+    solver->unknown--;
+    solver->probes++;
+    _enqueueLine(solver, cell / solver->size);
+    _enqueueLine(solver, solver->size + cell % solver->size);
+    return _propagate(solver, search->hints);
+}
+
+static void _restore(Solver *solver, const unsigned char *saved, int unknown)
+{
+    memcpy(solver->grid, saved, (size_t)solver->size * solver->size);
+    solver->unknown = unknown;
+}
+
+// Only cells next to something known are worth probing, the rest rarely lead
+// anywhere
+static bool _isProbeCandidate(Solver *solver, int cell)
+{
+    int size = solver->size;
+    int x = cell % size;
+    int y = cell / size;
+    if (solver->grid[cell] != CellState_Empty)
+        return false;
+    return (x > 0 && solver->grid[cell - 1] != CellState_Empty) || (x < size - 1 && solver->grid[cell + 1] != CellState_Empty)
+        || (y > 0 && solver->grid[cell - size] != CellState_Empty) || (y < size - 1 && solver->grid[cell + size] != CellState_Empty);
+}
+
+// Leaves the cells of agreed that grid has too and saved didn't know yet, the
+// rest become unknown
+static void _keepAgreed(unsigned char *agreed, const unsigned char *grid, const unsigned char *saved, size_t cells)
+{
+    for (size_t c = 0; c < cells; c++) {
+        if (saved[c] != CellState_Empty || agreed[c] != grid[c])
+            agreed[c] = CellState_Empty;
+    }
+}
+
+// Explores everything consistent with the current grid. Probing sets a cell
+// both ways and propagates; if one way contradicts, the other one is forced,
+// and so is every cell both ways agree on. When probing stops helping, the
+// search branches on the cell whose probes told the most. Returns false when
+// the search should stop.
+static bool _search(Search *search)
+{
+    Solver *solver = search->solver;
+    size_t cells = (size_t)solver->size * solver->size;
+    unsigned char *saved = (unsigned char *)malloc(2 * cells);
+    if (!saved) {
+        search->aborted = true;
+        return false;
+    }
+    unsigned char *agreed = saved + cells;
+
+    bool keepGoing = true;
+    bool progress = true;
+    int best = -1;
+    while (progress && solver->unknown > 0 && keepGoing) {
+        progress = false;
+        best = -1;
+        int bestScore = -1;
+        for (size_t cell = 0; cell < cells && solver->unknown > 0; cell++) {
+            if (!_isProbeCandidate(solver, (int)cell))
+                continue;
+            if (solver->probes >= search->maxProbes) {
+                search->aborted = true;
+                keepGoing = false;
+                break;
+            }
+
+            int unknown = solver->unknown;
+            SolveResult results[2];
+            int learned[2];
+            const unsigned char values[2] = { CellState_Filled, CellState_Cross };
+            memcpy(saved, solver->grid, cells);
+            for (int v = 0; v < 2 && keepGoing; v++) {
+                results[v] = _assume(search, (int)cell, values[v]);
+                learned[v] = unknown - solver->unknown;
+                if (results[v] == SolveResult_Solved)
+                    keepGoing = _recordSolution(search);
+                if (v == 0)
+                    memcpy(agreed, solver->grid, cells);
+                else
+                    _keepAgreed(agreed, solver->grid, saved, cells);
+                _restore(solver, saved, unknown);
+            }
+            if (!keepGoing)
+                break;
+
+            if (results[0] == SolveResult_Contradiction && results[1] == SolveResult_Contradiction) {
+                free(saved);
+                return true; // dead end
+            }
+            if (results[0] == SolveResult_Contradiction || results[1] == SolveResult_Contradiction) {
+                // only one value works here, keep it (any solution it led to is recorded)
+                SolveResult r = _assume(search, (int)cell, results[0] == SolveResult_Contradiction ? values[1] : values[0]);
+                if (r == SolveResult_Contradiction) {
+                    free(saved);
+                    return true;
+                }
+                progress = true;
+                continue;
+            }
+
+            // cells both ways set alike are known whichever way this one goes
+            int forced = 0;
+            if (learned[0] > 1 && learned[1] > 1) {
+                for (size_t c = 0; c < cells; c++) {
+                    if (agreed[c] == CellState_Empty)
+                        continue;
+                    solver->grid[c] = agreed[c];
+                    solver->unknown--;
+                    _enqueueLine(solver, (int)c / solver->size);
+                    _enqueueLine(solver, solver->size + (int)c % solver->size);
+                    forced++;
+                }
+            }
+            if (forced > 0) {
+                SolveResult r = _propagate(solver, search->hints);
+                if (r == SolveResult_Contradiction) {
+                    free(saved);
+                    return true;
+                }
+                if (r == SolveResult_Solved) {
+                    keepGoing = _recordSolution(search);
+                    break;
+                }
+                progress = true;
+                continue;
+            }
+
+            int score = learned[0] < learned[1] ? learned[0] : learned[1];
+            if (score > bestScore) {
+                bestScore = score;
+                best = (int)cell;
+            }
+        }
+    }
+
+    if (keepGoing && solver->unknown > 0) {
+        if (best < 0) {
+            // nothing known next to any unknown cell, branch on the first one
+            best = (int)((const unsigned char *)memchr(solver->grid, CellState_Empty, cells) - solver->grid);
+        }
+        int unknown = solver->unknown;
+        memcpy(saved, solver->grid, cells);
+        unsigned char values[2] = { CellState_Filled, CellState_Cross };
+        if (search->numSolutions == 1 && search->solutions[0][best] == CellState_Filled) {
+            // a second solution has to differ somewhere, try that first
+            values[0] = CellState_Cross;
+            values[1] = CellState_Filled;
+        }
+        for (int v = 0; v < 2 && keepGoing; v++) {
+            SolveResult r = _assume(search, best, values[v]);
+            if (r == SolveResult_Solved)
+                keepGoing = _recordSolution(search);
+            else if (r == SolveResult_Stuck)
+                keepGoing = _search(search);
+            _restore(solver, saved, unknown);
+        }
+    }
+
+    free(saved);
+    return keepGoing;
+}
+
+static void _destroyCache(Solver *solver)
+{
+    free(solver->cache);
+    free(solver->cacheCells);
+    solver->cache = NULL;
+    solver->cacheCells = NULL;
+    solver->cacheSlots = 0;
+}
+
+// Gives the solver a line cache of about SOLVER_CACHE_BYTES, the search works
+// without one if this fails
+static void _createCache(Solver *solver)
+{
+    int slots = 64;
+    while ((size_t)slots * 4 * solver->size <= SOLVER_CACHE_BYTES)
+        slots *= 2;
+    solver->cache = (LineCacheEntry *)calloc(slots, sizeof(LineCacheEntry));
+    solver->cacheCells = (unsigned char *)malloc((size_t)slots * 2 * solver->size);
+    solver->cacheSlots = slots;
+    if (!solver->cache || !solver->cacheCells) {
+        LOG_MESSAGE(MTNLOG_WARNING, "solver", "Failed to allocate the line cache, searching without it");
+        _destroyCache(solver);
+    }
+}
+
+UniqueResult solverCheckUnique(Solver *solver, BoardHints *hints, long maxProbes, unsigned char *first, unsigned char *second)
+{
+    size_t cells = (size_t)solver->size * solver->size;
+    Search search;
+    memset(&search, 0, sizeof(Search));
+    search.solver = solver;
+    search.hints = hints;
+    search.maxProbes = maxProbes;
+    search.solutions[0] = first ? first : (unsigned char *)malloc(cells);
+    search.solutions[1] = second ? second : (unsigned char *)malloc(cells);
+
+    UniqueResult result;
+    solver->probes = 0;
+    if (!search.solutions[0] || !search.solutions[1]) {
+        result = UniqueResult_AllocationError;
+    } else {
+        SolveResult r = solverSolve(solver, hints);
+        if (r == SolveResult_Solved) {
+            _recordSolution(&search);
+        } else if (r == SolveResult_Stuck) {
+            _createCache(solver);
+            _search(&search);
+            _destroyCache(solver);
+        }
+
+        if (search.numSolutions == 2)
+            result = UniqueResult_Multiple;
+        else if (search.aborted)
+            result = UniqueResult_Unknown;
+        else if (search.numSolutions == 1)
+            result = UniqueResult_Unique;
+        else
+            result = UniqueResult_NoSolution;
+    }
+
+    // leave the first solution in the grid
+    if (search.numSolutions > 0) {
+        memcpy(solver->grid, search.solutions[0], cells);
+        solver->unknown = 0;
+    }
+
+    if (!first)
+        free(search.solutions[0]);
+    if (!second)
+        free(search.solutions[1]);
+    return result;
+}
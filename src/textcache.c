@@ -0,0 +1,125 @@
+#include "textcache.h"
+#include "profiler.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void textCacheInit(TextCache *cache, FC_Font *font)
+{
+    memset(cache, 0, sizeof(TextCache));
+    cache->font = font;
+}
+
+void textCacheDestroy(TextCache *cache)
+{
+    textCacheInvalidate(cache);
+}
+
+// Drops every texture, e.g. after the renderer lost its contents
+void textCacheInvalidate(TextCache *cache)
+{
+    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (cache->entries[i].texture)
+            SDL_DestroyTexture(cache->entries[i].texture);
+    }
+    memset(cache->entries, 0, sizeof(cache->entries));
+}
+
+static bool _sameColor(SDL_Color a, SDL_Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static TextCacheEntry *_find(TextCache *cache, const char *text, float scale, SDL_Color color)
+{
+    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+        TextCacheEntry *entry = &cache->entries[i];
+        if (entry->lastUsed && entry->scale == scale && _sameColor(entry->color, color) && strcmp(entry->text, text) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+// Switching render targets resets the clip rect, so whatever the caller was
+// drawing into gets its target and clip rect back afterwards
+static bool _render(TextCache *cache, SDL_Renderer *rend, TextCacheEntry *entry, const char *text, float scale, SDL_Color color)
+{
+    int w = (int)(FC_GetWidth(cache->font, "%s", text) * scale) + 2;
+    int h = (int)(FC_GetLineHeight(cache->font) * scale) + 2;
+    if (!entry->texture || entry->texW < w || entry->texH < h) {
+        if (entry->texture)
+            SDL_DestroyTexture(entry->texture);
+        // leave some room so a growing timer keeps its texture
+        entry->texW = (w + 63) & ~63;
+        entry->texH = h;
+        entry->texture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, entry->texW, entry->texH);
+        if (!entry->texture) {
+            entry->lastUsed = 0;
+            return false;
+        }
+        PROFILE_ALLOC((size_t)entry->texW * entry->texH * 4);
+        SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_Texture *oldTarget = SDL_GetRenderTarget(rend);
+    SDL_Rect clip;
+    SDL_RenderGetClipRect(rend, &clip);
+
+    SDL_SetRenderTarget(rend, entry->texture);
+    SDL_SetRenderDrawColor(rend, 0, 0, 0, 0);
+    SDL_RenderClear(rend);
+    FC_DrawEffect(cache->font, rend, 0, 0, FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(scale, scale), color), "%s", text);
+
+    SDL_SetRenderTarget(rend, oldTarget);
+    SDL_RenderSetClipRect(rend, clip.w > 0 && clip.h > 0 ? &clip : NULL);
+
+    strcpy(entry->text, text);
+    entry->scale = scale;
+    entry->color = color;
+    entry->w = w;
+    entry->h = h;
+    return true;
+}
+
+// Draws the formatted string at x, y and returns the area it covers
+SDL_Rect textCacheDraw(TextCache *cache, SDL_Renderer *rend, int x, int y, float scale, SDL_Color color, const char *fmt, ...)
+{
+    char text[TEXT_CACHE_MAX_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if (len < 0 || len >= TEXT_CACHE_MAX_LEN) {
+        // too long to cache, draw it the slow way
+        char *longText = len > 0 ? (char *)malloc(len + 1) : NULL;
+        SDL_Rect rect = {x, y, 0, 0};
+        if (longText) {
+            va_start(args, fmt);
+            vsnprintf(longText, len + 1, fmt, args);
+            va_end(args);
+            rect = FC_DrawEffect(cache->font, rend, x, y, FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(scale, scale), color), "%s", longText);
+            free(longText);
+        }
+        return rect;
+    }
+
+    TextCacheEntry *entry = _find(cache, text, scale, color);
+    if (!entry) {
+        entry = &cache->entries[0];
+        for (int i = 1; i < TEXT_CACHE_SIZE; i++) {
+            if (cache->entries[i].lastUsed < entry->lastUsed)
+                entry = &cache->entries[i];
+        }
+        if (!_render(cache, rend, entry, text, scale, color))
+            return FC_DrawEffect(cache->font, rend, x, y, FC_MakeEffect(FC_ALIGN_LEFT, FC_MakeScale(scale, scale), color), "%s", text);
+    }
+    entry->lastUsed = ++cache->useCounter;
+
+    SDL_Rect src = {0, 0, entry->w, entry->h};
+    SDL_Rect dst = {x, y, entry->w, entry->h};
+    SDL_RenderCopy(rend, entry->texture, &src, &dst);
+    return dst;
+}
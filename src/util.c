@@ -3,9 +3,15 @@
 #include <errno.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #ifdef WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 void sleepMs(int ms)
@@ -29,6 +35,21 @@ void sleepMs(int ms)
 #endif
 }
 
+uint64_t monotonicNs(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000ull + (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000ull / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
 bool isNumberStr(const char *str)
 {
     for (int i = 0; str[i]; i++)
@@ -36,3 +57,63 @@ bool isNumberStr(const char *str)
             return false;
     return true;
 }
+
+// Maps a file into memory, or reads it where mmap isn't available
+const char *mapFile(const char *name, size_t *len)
+{
+#ifdef WIN32
+    FILE *fp = fopen(name, "rb");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    long fileLen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buf = (char *)malloc(fileLen > 0 ? fileLen : 1);
+    if (buf && fread(buf, 1, fileLen, fp) != (size_t)fileLen) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    *len = fileLen;
+    return buf;
+#else
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    *len = st.st_size;
+    if (*len == 0) {
+        close(fd);
+        return "";
+    }
+    void *buf = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return buf == MAP_FAILED ? NULL : (const char *)buf;
+#endif
+}
+
+void unmapFile(const char *buf, size_t len)
+{
+#ifdef WIN32
+    (void)len;
+    free((char *)buf);
+#else
+    if (len > 0)
+        munmap((void *)buf, len);
+#endif
+}
+
+uint64_t hashBytes(const void *data, size_t len, uint64_t hash)
+{
+    // FNV-1a
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
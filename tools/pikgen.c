@@ -0,0 +1,156 @@
+// Generates random levels with unique, line solvable solutions
+#include "generator.h"
+#include "pack.h"
+#include "board.h"
+#include "util.h"
+#include "mtnlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static void _printUsage(const char *name)
+{
+    printf("pikgen - generate Pikurosu levels\nUsage: %s [options] <output dir or " PACK_EXTENSION ">\n", name);
+    printf("\n --count [n] - number of levels (default 100)\n");
+    printf(" --size [n] - board size (default 15)\n");
+    printf(" --density [0-1] - chance of a cell being filled (default 0.6)\n");
+    printf(" --difficulty [any/easy/medium/hard] - difficulty band (default any)\n");
+    printf(" --seed [n] - random seed, the same seed gives the same levels (default 1)\n");
+    printf(" --attempts [n] - candidates tried per level before giving up (default 10000)\n");
+    printf(" --threads [n] - number of worker threads (default one per core)\n");
+    printf(" --hints - store precomputed clues when writing a pack\n");
+}
+
+static bool _parseDifficulty(const char *str, GeneratorDifficulty *difficulty)
+{
+    for (int i = GeneratorDifficulty_Any; i <= GeneratorDifficulty_Hard; i++) {
+        if (strcmp(str, generatorDifficultyString((GeneratorDifficulty)i)) == 0) {
+            *difficulty = (GeneratorDifficulty)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool _isPackName(const char *name)
+{
+    size_t len = strlen(name);
+    size_t extLen = strlen(PACK_EXTENSION);
+    return len > extLen && strcmp(name + len - extLen, PACK_EXTENSION) == 0;
+}
+
+// Writes the levels that were found, named after the seed and their index so
+// runs with different seeds can share a directory
+static int _writeLevels(GeneratedLevels *levels, GeneratorOptions *options, const char *output, bool withHints)
+{
+    bool pack = _isPackName(output);
+    PackWriter writer;
+    if (pack) {
+        packWriterCreate(&writer, withHints);
+    } else if (mkdir(output, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "%s: can't create directory\n", output);
+        return -1;
+    }
+
+    int written = 0;
+    for (int i = 0; i < levels->count; i++) {
+        Board board;
+        if (!generatorLoadLevel(levels, i, &board))
+            continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "Random %s #%llu-%d", generatorDifficultyString(options->difficulty), (unsigned long long)options->seed, i + 1);
+        BoardMetadata meta;
+        meta.name = name;
+        meta.author = (char *)"pikgen";
+
+        bool ok;
+        if (pack) {
+            ok = packWriterAdd(&writer, &board, &meta);
+        } else {
+            size_t len = strlen(output) + 64;
+            char *path = (char *)malloc(len);
+            ok = path != NULL;
+            if (ok) {
+                snprintf(path, len, "%s/gen-%llu-%05d.pikurosu", output, (unsigned long long)options->seed, i + 1);
+                ok = boardSave(&board, &meta, path);
+            }
+            free(path);
+        }
+        boardDestroy(&board);
+        if (!ok)
+            break;
+        written++;
+    }
+
+    if (pack) {
+        if (!packWriterSave(&writer, output))
+            written = -1;
+        packWriterDestroy(&writer);
+    }
+    return written;
+}
+
+int main(int argc, char **argv)
+{
+    GeneratorOptions options;
+    memset(&options, 0, sizeof(GeneratorOptions));
+    options.size = 15;
+    options.density = 0.6;
+    options.difficulty = GeneratorDifficulty_Any;
+    options.seed = 1;
+    options.maxAttempts = 10000;
+    int count = 100;
+    bool withHints = false;
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--hints") == 0) {
+            withHints = true;
+        } else if (strcmp(arg, "--count") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            count = atoi(argv[++i]);
+        } else if (strcmp(arg, "--size") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.size = atoi(argv[++i]);
+        } else if (strcmp(arg, "--density") == 0 && hasValue) {
+            options.density = atof(argv[++i]);
+        } else if (strcmp(arg, "--difficulty") == 0 && hasValue && _parseDifficulty(argv[i + 1], &options.difficulty)) {
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--attempts") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.maxAttempts = atoi(argv[++i]);
+        } else if (strcmp(arg, "--threads") == 0 && hasValue && isNumberStr(argv[i + 1])) {
+            options.numThreads = atoi(argv[++i]);
+        } else if (arg[0] != '-' && !output) {
+            output = arg;
+        } else {
+            _printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!output || options.density <= 0.0 || options.density > 1.0) {
+        _printUsage(argv[0]);
+        return 1;
+    }
+
+    mtnlogInit(MTNLOG_WARNING, "pikgen.log");
+
+    GeneratedLevels levels;
+    uint64_t start = monotonicNs();
+    if (!generatorRun(&options, count, &levels)) {
+        fprintf(stderr, "Failed to generate levels\n");
+        return 1;
+    }
+    double seconds = (monotonicNs() - start) / 1e9;
+
+    int written = _writeLevels(&levels, &options, output, withHints);
+    if (written >= 0)
+        printf("Wrote %d of %d levels to %s in %.2f s (%ld candidates)\n", written, count, output, seconds, levels.attempts);
+    generatorDestroy(&levels);
+    return written == count ? 0 : 1;
+}
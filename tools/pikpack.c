@@ -0,0 +1,112 @@
+// Builds a level pack out of directories of .pikurosu files
+#include "pack.h"
+#include "board.h"
+#include "mtnlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static int _comparePaths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool _addLevel(PackWriter *writer, const char *path)
+{
+    Board board;
+    BoardMetadata meta;
+    BoardLoadError err;
+    if (!boardLoad(&board, &meta, path, &err)) {
+        fprintf(stderr, "%s:%d:%d: %s\n", path, err.line, err.column, boardLoadResultString(err.result));
+        return false;
+    }
+
+    bool ok = packWriterAdd(writer, &board, &meta);
+    if (!ok)
+        fprintf(stderr, "%s: failed to add level to pack\n", path);
+    boardDestroy(&board);
+    boardMetaDestroy(&meta);
+    return ok;
+}
+
+// Adds every regular file in dir in name order. Returns the number of levels
+// that failed to load.
+static int _addDir(PackWriter *writer, const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "%s: can't open directory\n", dir);
+        return 1;
+    }
+
+    char **paths = NULL;
+    int numPaths = 0;
+    int cap = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_type != DT_REG)
+            continue;
+        if (numPaths == cap) {
+            cap = cap ? cap * 2 : 64;
+            char **newPaths = (char **)realloc(paths, cap * sizeof(char *));
+            if (!newPaths)
+                break;
+            paths = newPaths;
+        }
+        size_t len = strlen(dir) + strlen(de->d_name) + 2;
+        paths[numPaths] = (char *)malloc(len);
+        if (!paths[numPaths])
+            break;
+        snprintf(paths[numPaths], len, "%s/%s", dir, de->d_name);
+        numPaths++;
+    }
+    closedir(d);
+
+    qsort(paths, numPaths, sizeof(char *), _comparePaths);
+    int failed = 0;
+    for (int i = 0; i < numPaths; i++) {
+        if (!_addLevel(writer, paths[i]))
+            failed++;
+        free(paths[i]);
+    }
+    free(paths);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    bool withHints = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--hints") == 0) {
+        withHints = true;
+        first++;
+    }
+
+    if (argc - first < 2) {
+        printf("pikpack - build Pikurosu level packs\nUsage: %s [--hints] <output" PACK_EXTENSION "> <dir or level>...\n", argv[0]);
+        printf("\n --hints - store precomputed clues in the pack\n");
+        return 1;
+    }
+
+    mtnlogInit(MTNLOG_WARNING, "pikpack.log");
+
+    PackWriter writer;
+    packWriterCreate(&writer, withHints);
+
+    int failed = 0;
+    for (int i = first + 1; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+            failed += _addDir(&writer, argv[i]);
+        else if (!_addLevel(&writer, argv[i]))
+            failed++;
+    }
+
+    bool ok = packWriterSave(&writer, argv[first]);
+    if (ok)
+        printf("Wrote %d levels to %s (%d failed)\n", writer.numLevels, argv[first], failed);
+    packWriterDestroy(&writer);
+    return ok && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// Replays recorded play sessions without a window and checks the final board
+#include "replay.h"
+#include "play.h"
+#include "board.h"
+#include "hints.h"
+#include "util.h"
+#include "mtnlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void _printUsage(const char *name)
+{
+    printf("pikreplay - replay recorded Pikurosu sessions as fast as possible\nUsage: %s [options] <recording>...\n", name);
+    printf("\n --repeat [n] - replay every recording n times (default 1)\n");
+    printf("\nRecordings come from running the game with --record [file].\n");
+}
+
+// Returns whether every run ended on the recorded board
+static bool _replay(const char *name, int repeat)
+{
+    Replay replay;
+    if (!replayOpen(&replay, name)) {
+        fprintf(stderr, "%s: can't read recording\n", name);
+        return false;
+    }
+
+    bool ok = true;
+    long cellsChanged = 0;
+    uint64_t totalNs = 0;
+    for (int r = 0; r < repeat && ok; r++) {
+        Board board;
+        BoardHints hints;
+        Play play;
+        PlayEvent ev;
+        uint32_t deltaMs;
+        if (!replayLoadBoard(&replay, &board)) {
+            fprintf(stderr, "%s: can't create board\n", name);
+            ok = false;
+            break;
+        }
+        // the clues take up room on screen, so they decide where the clicks land
+        if (!hintsCreate(&hints, &board)) {
+            fprintf(stderr, "%s: can't create clues\n", name);
+            boardDestroy(&board);
+            ok = false;
+            break;
+        }
+        memset(&play, 0, sizeof(Play));
+        replayRewind(&replay);
+
+        uint64_t start = monotonicNs();
+        playStart(&play, &board, &hints, replay.viewW, replay.viewH);
+        while (replayNext(&replay, &ev, &deltaMs))
+            playHandleEvent(&play, &ev);
+        totalNs += monotonicNs() - start;
+
+        cellsChanged = play.cellsChanged;
+        if (replayBoardHash(&board) != replay.finalHash || play.solved != replay.finalSolved) {
+            fprintf(stderr, "%s: run %d ended on a different board than the recording\n", name, r + 1);
+            ok = false;
+        }
+        hintsDestroy(&hints);
+        boardDestroy(&board);
+    }
+
+    double perRunMs = totalNs / 1e6 / repeat;
+    double eventsPerSec = totalNs ? replay.numEvents * (double)repeat / (totalNs / 1e9) : 0.0;
+    printf("%s: %dx%d, %ld events, %ld cells changed, %s, %.3f ms per run, %.0f events/s, %.0fx faster than recorded: %s\n",
+        name, replay.boardSize, replay.boardSize, replay.numEvents, cellsChanged, replay.finalSolved ? "solved" : "not solved",
+        perRunMs, eventsPerSec, perRunMs > 0.0 ? replay.durationMs / perRunMs : 0.0, ok ? "ok" : "MISMATCH");
+    replayClose(&replay);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = 1;
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--repeat") == 0 && i + 1 < argc && isNumberStr(argv[i + 1]) && atoi(argv[i + 1]) > 0) {
+            repeat = atoi(argv[++i]);
+        } else if (arg[0] != '-') {
+            first = i;
+            break;
+        } else {
+            _printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (first == argc) {
+        _printUsage(argv[0]);
+        return 1;
+    }
+
+    mtnlogInit(MTNLOG_WARNING, "pikreplay.log");
+
+    int failed = 0;
+    for (int i = first; i < argc; i++)
+        failed += !_replay(argv[i], repeat);
+    return failed ? 1 : 0;
+}